@@ -0,0 +1,26 @@
+#ifndef _ARRAY_IO_HPP_
+#define _ARRAY_IO_HPP_
+
+#include "basic_types.hpp"
+#include "ArrayStorage.hpp"
+#include <string>
+#include <vector>
+
+
+namespace gvl
+{
+    // Bulk transfer of arrays from and to files. Formats:
+    //   i32, i64, f32, f64    raw little-endian binary, no header
+    //   csv, csv:N            one row per element, taken from column N (0 by default)
+    // Errors (unknown format, unreadable file, non numeric element) throw std::runtime_error.
+    class ArrayIO
+    {
+        public:
+
+            static std::vector<Token> load(const std::string& file_name, const std::string& format);
+
+            static void save(const ArrayStorage& elements, const std::string& file_name, const std::string& format);
+    };
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _ARRAY_OPS_HPP_
+#define _ARRAY_OPS_HPP_
+
+#include "basic_types.hpp"
+#include "ArrayStorage.hpp"
+#include <cstddef>
+#include <vector>
+
+
+namespace gvl
+{
+    // Ordering operations on arrays. Elements are compared as numbers when all of them are numbers
+    // and as text otherwise. Sorting is stable; large arrays are sorted as runs on the shared thread
+    // pool, which are then merged pairwise, the merges of a round running in parallel as well.
+    class ArrayOps
+    {
+        public:
+
+            static void sort(ArrayStorage& elements, bool descending);
+
+            // index of the first element equal to value in an ascending array, the array's size when there is none
+            static std::size_t bsearch(const ArrayStorage& elements, TokenSv value);
+
+            // the elements without repeats, in order of first appearance, numbers equal in value are repeats
+            static std::vector<Token> unique(const ArrayStorage& elements);
+    };
+}
+
+#endif
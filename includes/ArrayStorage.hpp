@@ -0,0 +1,118 @@
+#ifndef _ARRAY_STORAGE_HPP_
+#define _ARRAY_STORAGE_HPP_
+
+#include "basic_types.hpp"
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+
+namespace gvl
+{
+    // Elements of an array variable: a window [offset, offset + length) over a vector that may be
+    // shared with other arrays. Copies and slices only share the vector; the first write through
+    // an array that does not own it alone copies its window out (copy-on-write).
+    class ArrayStorage
+    {
+        public:
+
+            using const_iterator = std::vector<Token>::const_iterator;
+
+            ArrayStorage() = default;
+
+            ArrayStorage(std::vector<Token> elements)
+                : data(std::make_shared<std::vector<Token>>(std::move(elements))), length(data->size())
+            {}
+
+            // throws std::out_of_range unless begin <= end <= source.size()
+            static ArrayStorage slice(const ArrayStorage& source, std::size_t begin, std::size_t end)
+            {
+                if (begin > end || end > source.length)
+                    throw std::out_of_range("array slice out of range");
+
+                ArrayStorage view;
+                view.data = source.data;
+                view.offset = source.offset + begin;
+                view.length = end - begin;
+                return view;
+            }
+
+            inline std::size_t size() const { return length; }
+
+            inline bool empty() const { return length == 0; }
+
+            inline const_iterator begin() const { return data ? data->cbegin() + offset : empty_elements().cbegin(); }
+
+            inline const_iterator end() const { return begin() + length; }
+
+            inline const Token& operator[](std::size_t idx) const { return (*data)[offset + idx]; }
+
+            inline const Token& at(std::size_t idx) const
+            {
+                if (idx >= length)
+                    throw std::out_of_range("array index out of range");
+                return (*data)[offset + idx];
+            }
+
+            inline const Token& back() const { return (*data)[offset + length - 1]; }
+
+            // true while other arrays still see the same elements
+            inline bool is_shared() const { return data && data.use_count() > 1; }
+
+            void set(std::size_t idx, const Token& value)
+            {
+                if (idx >= length)
+                    throw std::out_of_range("array index out of range");
+
+                detach();
+                (*data)[offset + idx] = value;
+            }
+
+            void push_back(const Token& value)
+            {
+                if (!data || is_shared() || offset + length != data->size())
+                    detach();
+
+                data->push_back(value);
+                ++length;
+            }
+
+            // shrinking the window never needs a copy
+            void pop_back()
+            {
+                if (length == 0)
+                    return;
+
+                if (!is_shared() && offset + length == data->size())
+                    data->pop_back();
+
+                --length;
+            }
+
+        private:
+
+            void detach()
+            {
+                if (data && !is_shared() && offset == 0 && length == data->size())
+                    return;
+
+                data = std::make_shared<std::vector<Token>>(begin(), end());
+                offset = 0;
+            }
+
+            static const std::vector<Token>& empty_elements()
+            {
+                static const std::vector<Token> empty;
+                return empty;
+            }
+
+        private:
+
+            std::shared_ptr<std::vector<Token>> data;
+            std::size_t offset=0;
+            std::size_t length=0;
+    };
+}
+
+#endif
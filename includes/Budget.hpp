@@ -0,0 +1,80 @@
+#ifndef _BUDGET_HPP_
+#define _BUDGET_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+
+
+namespace gvl
+{
+    // Limits on the statements a run may execute, the wall-clock and CPU time it may take and the heap memory
+    // it may add. Every run counts against a Budget of its own, installed on the threads working for it.
+    // Statements are counted where they are dispatched, loops compiled to native code are charged their
+    // bodies at every back-edge, and growing containers charge the bytes they add. Every thread counts on its
+    // own and compares against the limits only once check_interval statements (fewer under a lower statement
+    // limit) or check_bytes bytes have piled up. A limit that is exceeded stops the script with an
+    // Interpreter::RunTimeError.
+    class Budget
+    {
+        public:
+
+            // 0 leaves a limit off
+            struct Limits
+            {
+                std::uint64_t statements=0;
+                std::uint64_t time=0;           // milliseconds of wall-clock time
+                std::uint64_t cpu_time=0;       // milliseconds of CPU time, of every thread of the process
+                std::uint64_t memory=0;         // bytes the heap of the process grows by
+
+                inline bool any() const { return statements > 0 || time > 0 || cpu_time > 0 || memory > 0; }
+            };
+
+            static constexpr std::uint64_t check_interval = 4096;
+            static constexpr std::uint64_t check_bytes = 1 << 20;
+            static constexpr std::uint64_t native_interval = 1 << 20;
+
+            // the run begins: clocks, counters and the memory baseline start from here
+            explicit Budget(const Limits& limits);
+
+            // the calling thread counts against budget from here, nullptr or a budget without limits counts
+            // nothing; what it had pending goes to the budget it was counted for and it starts from zero
+            static void install(Budget* budget);
+
+            static inline bool is_enabled() { return active != nullptr; }
+
+            static inline void count(std::uint64_t statements=1)
+            {
+                if (active != nullptr && (pending_statements += statements) >= active->batch)
+                    check();
+            }
+
+            static inline void allocate(std::uint64_t bytes)
+            {
+                if (active != nullptr && (pending_bytes += bytes) >= check_bytes)
+                    check();
+            }
+
+            // throws Interpreter::RunTimeError once a limit of the installed budget is exceeded
+            static void check();
+
+            // statements a loop compiled to native code may run before the limits are checked again
+            static std::uint64_t fuel();
+
+        private:
+
+            const Limits limits;
+            const std::uint64_t batch;
+            const std::chrono::steady_clock::time_point started;
+            const std::uint64_t cpu_started;
+            const std::uint64_t memory_baseline;
+            std::atomic<std::uint64_t> statements=0;
+
+            static thread_local Budget* active;
+            static thread_local std::uint64_t pending_statements;
+            static thread_local std::uint64_t pending_bytes;
+    };
+}
+
+#endif
@@ -17,6 +17,7 @@ class Calculator
     
         static constexpr char operators[] = "+-*/%^>=<";
         static constexpr char whitespace_chars[] = "' ' ";
+        static constexpr char negative_sign = '~';
 
         class Exception
         {
@@ -72,6 +73,17 @@ class Calculator
             return c == '(' || c == ')';
         }
 
+        static bool is_unary_minus(const string& infix_expression, std::size_t i) noexcept
+        {
+            if (infix_expression[i] != '-')
+                return false;
+
+            while (i > 0 && infix_expression[i - 1] == ' ')
+                --i;
+
+            return i == 0 || is_operator(infix_expression[i - 1]) || infix_expression[i - 1] == '(';
+        }
+
         static bool is_whitespace(char c) noexcept
         {
             for (std::size_t i = 0; i < sizeof(whitespace_chars); ++i)
@@ -92,12 +104,21 @@ class Calculator
                 case '*':
                     return left_operand * right_operand;
                 case '/':
+                    if constexpr (std::is_integral<T>())
+                    {
+                        if (right_operand == 0)
+                            throw Exception{ "division by zero" };
+                    }
                     return left_operand / right_operand;
                 case '^':
                     return std::pow(left_operand, right_operand);
                 case '%':
                     if constexpr (std::is_same<T, int>())
+                    {
+                        if (right_operand == 0)
+                            throw Exception{ "division by zero" };
                         return left_operand % right_operand;
+                    }
                     else
                         throw Exception{ "invalid operator '%' used for non integral type"};
                 default:
@@ -161,11 +182,15 @@ class Calculator
                     std::istringstream iss(postfix_expression.substr(i));
 
                     try {
-                        const string& operand = read_operand(iss);
+                        string operand = read_operand(iss);
+                        const std::size_t operand_sz = operand.size();
+                        
+                        if (operand.front() == negative_sign)
+                            operand.front() = '-';
                         operands.push(operand);
                         
-                        if (operand.size() > 1)
-                            i += operand.size() - 1;
+                        if (operand_sz > 1)
+                            i += operand_sz - 1;
                     } catch (const Exception& e) { throw e; }
                 }
                 else if (operands.size() >= 2)
@@ -224,6 +249,13 @@ class Calculator
                     if (operand.size() > 1)
                         i += operand.size() - 1;
                 }
+                else if (is_unary_minus(infix_expression, i))
+                {
+                    std::istringstream iss(infix_expression.substr(i + 1));
+                    const string& operand = read_operand(iss);
+                    postfix_expression += negative_sign + operand + " ";
+                    i += operand.size();
+                }
                 else if (c != '(' && c != ')')
                 {
                     while (!s.empty() && s.top() != '(' && has_higher_or_equal_precedence(s.top(), c))
@@ -0,0 +1,54 @@
+#ifndef _CHANNEL_HPP_
+#define _CHANNEL_HPP_
+
+#include "basic_types.hpp"
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <memory>
+
+
+namespace gvl
+{
+    // Bounded FIFO of values shared by spawned tasks. Scripts only ever hold the channel's
+    // handle, a plain string, so it survives the copies of the variables every task works on.
+    class Channel
+    {
+        public:
+
+            enum class Receive
+            {
+                VALUE,
+                EMPTY,
+                CLOSED
+            };
+
+            explicit Channel(std::size_t capacity);
+
+            // false when the channel is full, throws std::runtime_error once it is closed
+            bool try_send(const Token& value);
+
+            // CLOSED only after the channel was closed and every value sent before was received
+            Receive try_receive(Token& value);
+
+            void close();
+
+            // registers a new channel and returns its handle
+            static Token create(std::size_t capacity);
+
+            // nullptr for unknown handles
+            static std::shared_ptr<Channel> find(TokenSv handle);
+
+            // drops a registered channel, tasks still holding it keep it alive
+            static void forget(TokenSv handle);
+
+        private:
+
+            std::mutex mutex;
+            std::deque<Token> values;
+            std::size_t capacity;
+            bool closed=false;
+    };
+}
+
+#endif
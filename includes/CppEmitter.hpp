@@ -0,0 +1,20 @@
+#ifndef _CPP_EMITTER_HPP_
+#define _CPP_EMITTER_HPP_
+
+#include "basic_types.hpp"
+#include <string>
+
+
+namespace gvl
+{
+    // Translates a parsed Program into a standalone C++20 source file that links
+    // against the gvl runtime library (see Runtime.hpp and the 'runtime' make target).
+    class CppEmitter
+    {
+        public:
+
+            static std::string emit(const Program& program, const std::string& source_name);
+    };
+}
+
+#endif
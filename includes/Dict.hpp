@@ -0,0 +1,70 @@
+#ifndef _DICT_HPP_
+#define _DICT_HPP_
+
+#include "basic_types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <memory>
+
+
+namespace gvl
+{
+    // Elements of a dict variable. Entries are kept densely in insertion order and found through
+    // an open-addressing index with linear probing, whose slots hold entry positions only, so a
+    // probe touches one small array. Copies share the table until one of them is written to.
+    class Dict
+    {
+        public:
+
+            struct Entry
+            {
+                Token key;
+                Token value;
+                std::size_t hash;
+            };
+
+            using const_iterator = std::vector<Entry>::const_iterator;
+
+            // nullptr if key is missing
+            const Token* find(TokenSv key) const;
+
+            inline bool contains(TokenSv key) const { return find(key) != nullptr; }
+
+            void insert_or_assign(TokenSv key, const Token& value);
+
+            // removing moves the last entry into the hole, the order of the others is kept
+            bool erase(TokenSv key);
+
+            inline std::size_t size() const { return table ? table->entries.size() : 0; }
+
+            inline bool empty() const { return size() == 0; }
+
+            const_iterator begin() const;
+
+            const_iterator end() const;
+
+        private:
+
+            static constexpr std::uint32_t empty_slot = 0;
+
+            struct Table
+            {
+                std::vector<Entry> entries;
+                std::vector<std::uint32_t> slots;    // entry index + 1, or empty_slot
+            };
+
+            // slot holding key, or the empty slot where it would go
+            static std::size_t probe(const Table& t, TokenSv key, std::size_t hash);
+
+            void detach();
+
+            void grow();
+
+        private:
+
+            std::shared_ptr<Table> table;
+    };
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef _GENERATOR_HPP_
+#define _GENERATOR_HPP_
+
+#include "basic_types.hpp"
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+
+namespace gvl
+{
+    // Values a generator function yields, produced on demand by a C++20 coroutine. The coroutine
+    // frame keeps the generator's state between values and runs up to its next co_yield only when
+    // the next value is asked for, so nothing is produced ahead of its consumer.
+    class Generator
+    {
+        public:
+
+            struct promise_type
+            {
+                Token value;
+                std::exception_ptr error;
+
+                inline Generator get_return_object() { return Generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+                inline std::suspend_always initial_suspend() noexcept { return {}; }
+
+                inline std::suspend_always final_suspend() noexcept { return {}; }
+
+                inline std::suspend_always yield_value(Token yielded) { value = std::move(yielded); return {}; }
+
+                inline void return_void() {}
+
+                inline void unhandled_exception() { error = std::current_exception(); }
+            };
+
+            Generator(Generator&& other) noexcept
+                : handle(std::exchange(other.handle, nullptr))
+            {}
+
+            Generator& operator=(Generator&&) = delete;
+
+            ~Generator()
+            {
+                if (handle)
+                    handle.destroy();
+            }
+
+            // false once the generator is done, errors of its body are rethrown here
+            bool next(Token& value)
+            {
+                if (!handle || handle.done())
+                    return false;
+
+                handle.resume();
+
+                if (handle.promise().error)
+                    std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+
+                if (handle.done())
+                    return false;
+
+                value.swap(handle.promise().value);
+                return true;
+            }
+
+        private:
+
+            explicit Generator(std::coroutine_handle<promise_type> handle)
+                : handle(handle)
+            {}
+
+        private:
+
+            std::coroutine_handle<promise_type> handle;
+    };
+}
+
+#endif
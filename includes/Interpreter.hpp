@@ -3,11 +3,21 @@
 
 #include "Parser.hpp"
 #include "Calculator.hpp"
+#include "Jit.hpp"
+#include "LineReader.hpp"
+#include "ArrayStorage.hpp"
+#include "Dict.hpp"
+#include "MemoCache.hpp"
+#include "Generator.hpp"
+#include "Budget.hpp"
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
+#include <deque>
 #include <string>
 #include <functional>
+#include <memory>
+#include <iostream>
 
 
 namespace gvl
@@ -19,6 +29,7 @@ namespace gvl
         DOUBLE,
         STRING,
         ARRAY,
+        DICT,
         NONE
     };
     
@@ -28,25 +39,68 @@ namespace gvl
         TokenSv name;
         Token value;
         bool is_const=false;
-        std::vector<Token> array_elements;
-    };
-
-    
-    //bool operator==(const std::pair<TokenSv, Statement*>& lhs, std::pair<TokenSv, Statement*>& rhs) 
-    //{ return lhs.first == rhs.first && lhs.second == rhs.second; }
-
-    struct HashTokenStmtPair
-    {
-        std::size_t operator()(const std::pair<TokenSv, Statement*>& p) const { return std::hash<TokenSv>()(p.first) + std::hash<Statement*>()(p.second); }
+        ArrayStorage array_elements;
+        Dict dict_entries;
     };
 
     class Interpreter
     {
+        friend class Jit;
+        friend class Runtime;
+        friend class Execution;
+        friend class Optimizer;
+        friend class Snapshot;
+
         public:
 
             class Info
             {};
 
+            enum class ErrorCode
+            {
+                UNDEFINED_VARIABLE,
+                UNDEFINED_FUNCTION,
+                INDEX_OUT_OF_RANGE,
+                EMPTY_ARRAY,
+                MISSING_KEY,
+                INVALID_NUMBER,
+                INVALID_EXPRESSION,
+                INVALID_HANDLE,
+                FAILED_OPERATION,
+                LIMIT_EXCEEDED,
+                SYNTAX_ERROR
+            };
+
+            // an error of a running script, reported at the line of the statement it stopped at
+            class RunTimeError : public Error
+            {
+                public:
+
+                    RunTimeError(ErrorCode code, const std::string& error_msg, std::size_t error_line_no=0)
+                        : Error(error_msg, error_line_no), code(code)
+                    {}
+
+                    inline ErrorCode get_code() const { return code; }
+
+                    inline std::size_t get_line_no() const { return error_line_no; }
+
+                    // errors are thrown without a line, the statement they leave gives it
+                    inline void set_line_no(std::size_t line_no)
+                    {
+                        if (error_line_no == 0)
+                            error_line_no = line_no;
+                    }
+
+                private:
+
+                    ErrorCode code;
+            };
+
+            // what a run owns besides its variables: the functions it defined with the caches of the pure ones,
+            // its tasks and channels and its streams. Threads run in the context installed on them, runs in
+            // contexts of their own share none of it and may proceed in parallel
+            struct Context;
+
             using VarLikeMap = std::unordered_map<TokenSv, VarLike>;
             using ExeFunc = std::function<Info(Interpreter&, const Statement&)>;
             using ExePlan = std::vector<std::pair<const Statement&, ExeFunc>>;
@@ -54,22 +108,96 @@ namespace gvl
 
             Interpreter(const Program& program);
 
+            // the program run with other arguments than its own, it is only read
+            Interpreter(const Program& program, const std::array<Token, args_max_num>& args);
+
             void execute_program();
 
             inline const VarLikeMap& get_var_map() const { return variables; }
 
             inline const Calculator& get_calculator() const { return calculator; }
 
-            inline const std::unordered_map<TokenSv, char> get_format_keywords() const { return format_keywords; }
+            inline const std::unordered_map<TokenSv, char>& get_format_keywords() const { return format_keywords; }
 
-            inline const std::unordered_set<std::pair<TokenSv, Statement*>, HashTokenStmtPair> get_ud_funcs() const { return ud_funcs; }
+            // the definition each function name was last given
+            const std::unordered_map<TokenSv, Statement*>& get_ud_funcs() const;
 
             inline const ExePlan& get_exe_plan() const { return exe_plan; }
 
             void print_vars() const;
 
+            // the name a token of the body being run stands for: in a function's body the parameters and locals
+            // are slots, which every activation names on its own
+            TokenSv bound(TokenSv token) const;
+
+            const Token& bound(const Token& token) const;
+
+            static VarLikeType deduce_type(TokenSv value);
+
+            // forgets every variable of the calling thread and every function, task and channel of its context
+            static void reset_state();
+
+            static std::shared_ptr<Context> make_context();
+
+            static inline Context* get_context() { return context; }
+
+            // the spawned tasks and pfor iterations of the calling thread run in its context as well
+            static void set_context(Context* ctx);
+
+            // the context of the calling thread counts against limits from here, its tasks and pfor iterations included
+            static void start_budget(const Budget::Limits& limits);
+
+            static std::ostream& get_output_stream();
+
+            static void set_output_stream(std::ostream& out);
+
+            static std::istream& get_input_stream();
+
+            static void set_input_stream(std::istream& in);
+
+            // hits and misses of the result cache of every pure function defined so far
+            static void print_memo_stats(std::ostream& out);
+
         private:
 
+            // a block or function body being run: blocks and calls push frames on an explicit,
+            // heap allocated stack instead of recursing, so deep recursion does not use the native stack
+            struct Frame;
+            using CallStack = std::deque<Frame>;
+
+            // a function bound once for all of its activations, whose frames share it: the parameters and
+            // locals of the body are replaced by slots
+            struct BoundFunction
+            {
+                Statement function;
+                std::vector<Token> names;               // what every slot stands for, the three parameters come first
+                std::array<bool, 3> declared{};         // parameters the body declares a local of as well
+            };
+
+            // scope of a nested block, which shares the arguments of the enclosing one
+            explicit Interpreter(const Program::StmtContainer& body);
+
+            // runs until the stack is empty, or until the generator whose body is the bottom frame yields,
+            // which stores the value in yielded and returns true, running again resumes after the yield;
+            // errors leave it as a RunTimeError at the line of the statement that failed
+            static bool run(CallStack& frames, Token* yielded=nullptr);
+
+            static bool run_frames(CallStack& frames, Token* yielded);
+
+            // called in a catch block: the library reports errors with exceptions of its own, they are rethrown
+            // as the script's RunTimeError at line_no
+            [[noreturn]] static void rethrow_runtime_error(std::size_t line_no);
+
+            static void push_block(CallStack& frames, const Program::StmtContainer& body);
+
+            // ends the top frame, a while body starts over instead while its loop goes on and looping is allowed
+            static void finish_frame(CallStack& frames, bool looping=true);
+
+            // tokens of stmt are bound in caller, a null caller runs no function
+            static void push_call(CallStack& frames, const Statement& stmt, const Interpreter* caller);
+
+            void plan(const Program::StmtContainer& stmts);
+
             static Info execute_init(Interpreter& interpreter, const Statement& stmt);
 
             static Info execute_array_init(Interpreter& interpreter, const Statement& stmt);
@@ -79,6 +207,10 @@ namespace gvl
             static Info execute_array_pop(Interpreter& interpreter, const Statement& stmt);
 
             static Info execute_array_set(Interpreter& interpreter, const Statement& stmt);
+
+            static Info execute_array_save(Interpreter& interpreter, const Statement& stmt);
+
+            static Info execute_array_sort(Interpreter& interpreter, const Statement& stmt);
             
             static Info execute_assign(Interpreter& interpreter, const Statement& stmt);
             
@@ -90,17 +222,81 @@ namespace gvl
 
             static Info execute_call_func(Interpreter& interpreter, const Statement& stmt);
 
+            static Info execute_pfor(Interpreter& interpreter, const Statement& stmt);
+
+            static Info execute_spawn(Interpreter& interpreter, const Statement& stmt);
+
+            static Info execute_await(Interpreter& interpreter, const Statement& stmt);
+
+            static Info execute_channel_related(Interpreter& interpreter, const Statement& stmt);
+
+            static Info execute_dict_related(Interpreter& interpreter, const Statement& stmt);
+
+            static Info execute_checkpoint(Interpreter& interpreter, const Statement& stmt);
+
+            static void execute_body(Interpreter& interpreter, const Program::StmtContainer& body);
+
+            static bool evaluate_condition(const Interpreter& interpreter, const Statement& stmt);
+
+            // renames the parameters of func_stmt's body to the call's arguments
+            static void bind_arguments(Statement& func_stmt, const Statement& stmt);
+
+            // binds a private copy of a function for one call site, which the optimizer inlines: parameters become
+            // the arguments and the function's own variables get the suffix, so they do not clash with the caller's
+            static void bind_frame(Statement& func_copy, const std::array<Token, 3>& arguments, TokenSv suffix);
+
+            // the slots of func, made by its first call and kept until it is defined again
+            static std::shared_ptr<const BoundFunction> bind_function(const Statement& func);
+
+            // the names of the slots of one activation: the arguments, and the locals with the activation's suffix
+            static std::vector<Token> name_slots(const BoundFunction& bound, const std::array<Token, 3>& arguments, TokenSv suffix);
+
             static void clear_scope(Interpreter& interpreter, std::vector<TokenSv>& var_names);
 
+            // task and channel handles are plain strings held by a variable of the current scope
+            static void set_handle(Interpreter& interpreter, TokenSv name, const Token& handle);
+
+            // reader over the input stream or the file named by a 'for line in' statement
+            static LineReader open_lines(const Interpreter& interpreter, const Statement& stmt);
+
+            // copies the line into the loop variable, reusing its storage
+            static void set_line(Interpreter& interpreter, TokenSv name, std::string_view line);
+
+            // values of the generator called by a 'for value in call name ...' statement run in interpreter
+            static Generator open_generator(const Interpreter& interpreter, const Statement& stmt);
+
+            // a call of a generator function, run on its own frame stack inside the coroutine
+            static Generator generate(Statement call);
+
+            static void register_function(Statement& func_stmt);
+
+            // parses a body left unparsed, a syntax error in it is a RunTimeError
+            static const Statement* find_function(TokenSv name);
+
+            // result cache of a pure function, nullptr for other functions
+            static MemoCache* find_memo(TokenSv name);
+
+            // the argument values a pure function's results depend on, false when one is an array or a dict,
+            // which are not memoized
+            static bool memo_key(const std::array<Token, 3>& arguments, Token& key, std::array<bool, 3>& is_variable);
+
+            // values the arguments ended up with, false when a variable argument is gone
+            static bool memo_results(const std::array<Token, 3>& arguments, const std::array<bool, 3>& is_variable,
+                std::vector<Token>& results);
+
+            static void apply_memo(const std::array<Token, 3>& arguments, const std::vector<Token>& results);
+
         private:
 
-            static VarLikeMap variables;
-            static std::array<Token, args_max_num> args;
-            static std::size_t block_lvl;
+            // every thread owns its variables, pfor workers run on copies of the caller's
+            static thread_local VarLikeMap variables;
+            static thread_local std::array<Token, args_max_num> args;
+            static thread_local std::size_t block_lvl;
+            static thread_local Context* context;
             static std::unordered_map<TokenSv, char> format_keywords;
-            static std::unordered_set<std::pair<TokenSv, Statement*>, HashTokenStmtPair> ud_funcs;
             
             std::vector<TokenSv> tmp_var_names;
+            const std::vector<Token>* slots=nullptr;        // names of the slots of the function body it runs
             Calculator calculator;
             ExePlan exe_plan;
     };
@@ -0,0 +1,68 @@
+#ifndef _JIT_HPP_
+#define _JIT_HPP_
+
+#include "basic_types.hpp"
+#include <cstddef>
+
+
+namespace gvl
+{
+    class Interpreter;
+
+    // Tier-up compiler for hot 'while' loops. Loops whose body only assigns non-negative
+    // ints (variables, int literals, $array_at / $array_len on int arrays) are translated
+    // to x86-64 machine code, every other loop keeps running in the interpreter.
+    class Jit
+    {
+        public:
+
+            enum class Outcome
+            {
+                NOT_COMPILED,   // loop is outside of the supported subset, nothing was executed
+                FINISHED,       // loop ran natively until its condition became false
+                DEOPTIMIZED,    // a guard failed, the current iteration was finished by the interpreter
+                OUT_OF_FUEL     // the budget is due to be checked, the current iteration was run by the interpreter
+            };
+
+            // counts the iterations of one execution of a 'while' statement and compiles it once it gets hot
+            class HotLoop
+            {
+                public:
+
+                    HotLoop(Interpreter& interpreter, const Statement& loop)
+                        : interpreter(interpreter), loop(loop)
+                    {}
+
+                    // true when the loop has already run to completion natively
+                    bool tier_up();
+
+                    inline void count_iteration() { ++iterations; }
+
+                private:
+
+                    Interpreter& interpreter;
+                    const Statement& loop;
+                    std::size_t iterations=0;
+                    bool attempted=false;
+            };
+
+            static constexpr std::size_t default_hotness_threshold = 100;
+
+            static Outcome execute_loop(Interpreter& interpreter, const Statement& loop);
+
+            static inline bool is_enabled() { return enabled; }
+
+            static inline void set_enabled(bool value) { enabled = value; }
+
+            static inline std::size_t get_hotness_threshold() { return hotness_threshold; }
+
+            static inline void set_hotness_threshold(std::size_t value) { hotness_threshold = value; }
+
+        private:
+
+            static bool enabled;
+            static std::size_t hotness_threshold;
+    };
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef _LINE_READER_HPP_
+#define _LINE_READER_HPP_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <istream>
+#include <fstream>
+
+
+namespace gvl
+{
+    // Splits a stream into lines while reading it in chunks of at most a fixed size. Lines are handed
+    // out as views into the chunk, so memory stays constant no matter how large the input is; only a
+    // line longer than a whole chunk makes the buffer grow. A chunk is what the stream has ready, so
+    // the lines of a pipe are handed out as they arrive rather than once a whole chunk came in.
+    class LineReader
+    {
+        public:
+
+            static constexpr std::size_t default_chunk_size = 1 << 20;
+
+            explicit LineReader(std::istream& in, std::size_t chunk_size=default_chunk_size);
+
+            // throws std::runtime_error if the file can not be opened
+            explicit LineReader(const std::string& file_name, std::size_t chunk_size=default_chunk_size);
+
+            // line stays valid until the next call, a trailing '\r' is dropped
+            bool next(std::string_view& line);
+
+        private:
+
+            bool fill();
+
+        private:
+
+            std::unique_ptr<std::ifstream> file;
+            std::istream* in;
+            std::vector<char> buffer;
+            std::size_t begin=0;
+            std::size_t end=0;
+            std::size_t scanned=0;      // bytes after begin known to hold no newline
+            bool eof=false;
+    };
+}
+
+#endif
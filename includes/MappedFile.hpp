@@ -0,0 +1,71 @@
+#ifndef _MAPPED_FILE_HPP_
+#define _MAPPED_FILE_HPP_
+
+#include <string>
+#include <cstddef>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace gvl
+{
+    // A file mapped read-only into memory for as long as the object lives, read front to back.
+    class MappedFile
+    {
+        public:
+
+            explicit MappedFile(const std::string& file_name)
+            {
+                fd = open(file_name.c_str(), O_RDONLY);
+
+                struct stat st;
+                if (fd < 0 || fstat(fd, &st) != 0)
+                {
+                    if (fd >= 0)
+                        close(fd);
+                    throw std::runtime_error("can not open '" + file_name + "'");
+                }
+
+                size = static_cast<std::size_t>(st.st_size);
+
+                if (size > 0)
+                {
+                    void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                    if (memory == MAP_FAILED)
+                    {
+                        close(fd);
+                        throw std::runtime_error("can not map '" + file_name + "'");
+                    }
+
+                    madvise(memory, size, MADV_SEQUENTIAL);
+                    data = static_cast<const char*>(memory);
+                }
+            }
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            ~MappedFile()
+            {
+                if (data)
+                    munmap(const_cast<char*>(data), size);
+                close(fd);
+            }
+
+            inline const char* begin() const { return data; }
+
+            inline std::size_t get_size() const { return size; }
+
+        private:
+
+            int fd=-1;
+            const char* data=nullptr;
+            std::size_t size=0;
+    };
+}
+
+#endif
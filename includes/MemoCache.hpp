@@ -0,0 +1,57 @@
+#ifndef _MEMO_CACHE_HPP_
+#define _MEMO_CACHE_HPP_
+
+#include "basic_types.hpp"
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace gvl
+{
+    // Results of a pure function keyed on its argument values. At most capacity entries are kept,
+    // the least recently used one is dropped first. Calls from spawned tasks may share a cache.
+    class MemoCache
+    {
+        public:
+
+            explicit MemoCache(std::size_t capacity);
+
+            // counts a hit or a miss, a hit also makes the entry the most recently used one
+            bool lookup(const Token& key, std::vector<Token>& results);
+
+            void store(const Token& key, const std::vector<Token>& results);
+
+            // drops every entry, the hits and misses counted so far stay
+            void clear();
+
+            std::size_t get_hits() const;
+
+            std::size_t get_misses() const;
+
+            static inline std::size_t get_default_capacity() { return default_capacity; }
+
+            static inline void set_default_capacity(std::size_t capacity) { default_capacity = capacity; }
+
+        private:
+
+            struct Entry
+            {
+                Token key;
+                std::vector<Token> results;
+            };
+
+            static std::size_t default_capacity;
+
+            mutable std::mutex mutex;
+            std::list<Entry> entries;                                       // most recently used first
+            std::unordered_map<TokenSv, std::list<Entry>::iterator> index;  // views of the keys in entries
+            std::size_t capacity;
+            std::size_t hits=0;
+            std::size_t misses=0;
+    };
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef _OPTIMIZER_HPP_
+#define _OPTIMIZER_HPP_
+
+#include "basic_types.hpp"
+#include <cstddef>
+#include <atomic>
+
+
+namespace gvl
+{
+    // Rewrites a parsed program before it runs. Calls of small functions that call nothing are
+    // replaced by a block holding the function's bound body. Values computed by a while body from
+    // variables the loop never writes are hoisted in front of the loop, and a value a block computes
+    // twice from unchanged operands is computed once. Both are kept in hidden variables local to the
+    // enclosing block, so the variables a script ends up with do not change.
+    class Optimizer
+    {
+        public:
+
+            // parses the bodies of the functions the program's calls can reach first, the others stay unparsed
+            static void optimize(Program& program);
+
+            static inline bool is_enabled() { return enabled; }
+
+            static inline void set_enabled(bool value) { enabled = value; }
+
+            // every transformation is reported on stderr
+            static inline void set_reporting(bool value) { reporting = value; }
+
+            static inline bool get_reporting() { return reporting; }
+
+            // statements a function body may have at most to be inlined, 0 turns inlining off
+            static inline std::size_t get_inline_size() { return inline_size; }
+
+            static inline void set_inline_size(std::size_t size) { inline_size = size; }
+
+            // the block a call of function is replaced with, its locals get the suffix of the call site
+            static Statement inline_call(const Statement& call, const Statement& function, const Token& suffix);
+
+        private:
+
+            // read once per optimize(), a host may change them while other threads compile Scripts
+            static std::atomic<bool> enabled;
+            static std::atomic<bool> reporting;
+            static std::atomic<std::size_t> inline_size;
+    };
+}
+
+#endif
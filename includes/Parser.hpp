@@ -5,6 +5,8 @@
 #include <vector>
 #include <array>
 #include <sstream>
+#include <algorithm>
+#include <memory>
 #include "basic_types.hpp"
 
 
@@ -21,10 +23,34 @@ namespace gvl
                     ParseTimeError(const std::string& error_msg, std::size_t error_line_no)
                         : Error(error_msg, error_line_no)
                     {}
+
+                    inline const std::string& get_message() const { return error_msg; }
+
+                    inline std::size_t get_line_no() const { return error_line_no; }
             };
 
         public:
 
+            // 'reduce' clause of a pfor statement as (operator, variable) pairs, e.g. sum:total -> (sum, total)
+            using Reduction = std::pair<Token, Token>;
+
+            static std::vector<Reduction> get_pfor_reductions(const std::vector<Token>& tokens);
+
+            // 'pure noinline function name : ...' keeps its annotations in front of the 'function' token
+            static inline bool has_annotation(const Statement& stmt, TokenSv annotation)
+            { return std::find(stmt.line.begin(), stmt.line.end(), "function") > std::find(stmt.line.begin(), stmt.line.end(), annotation); }
+
+            static inline bool is_pure_function(const Statement& stmt) { return has_annotation(stmt, "pure"); }
+
+            // never substituted into its call sites by the optimizer
+            static inline bool is_noinline_function(const Statement& stmt) { return has_annotation(stmt, "noinline"); }
+
+            // hands out the values of its yield statements to a 'for value in call name ...' loop
+            static inline bool is_generator_function(const Statement& stmt) { return has_annotation(stmt, "generator"); }
+
+            static inline const Token& get_function_name(const Statement& stmt)
+            { return *(std::find(stmt.line.begin(), stmt.line.end(), "function") + 1); }
+
             static std::vector<std::string> split_to_lines(std::istringstream& iss);
 
             static std::istringstream read_file_content(const std::string& file_name, std::vector<char>& buffer);
@@ -33,11 +59,44 @@ namespace gvl
 
             inline const Program& get_parsed_program() const { return this->parsed_program; }
 
+            // the bodies of top-level functions that are not pure are only located at first, this parses one
+            // when it is needed, doing nothing for any other statement
+            static void parse_function_body(Statement& function);
+
             static inline const std::size_t get_line_no() { return line_no; }
 
+            static inline void reset_line_no() { line_no = 1; }
+
+        private:
+
+            using Lines = std::vector<std::string>;
+            using LineIter = Lines::const_iterator;
+
+            // for every line from first on that opens a block, the index of the line closing it, found by one scan
+            // of the lines, so that nested bodies are not scanned again for every level of nesting
+            struct Blocks
+            {
+                LineIter first;
+                std::vector<std::size_t> closers;
+            };
+
+            static Blocks index_blocks(LineIter begin, LineIter end);
+
+            // statements of the lines [begin, end), whose first line is line line_no; given the script the lines
+            // are taken from, function bodies are left unparsed
+            static std::vector<Statement> parse_lines(LineIter begin, LineIter end, const Blocks& blocks,
+                const std::shared_ptr<const Lines>* script=nullptr);
+
+            // moves it from the header of a block to its closing bracket, returns where the body starts
+            static LineIter skip_body(LineIter& it, LineIter end, const Blocks& blocks);
+
+            // cuts the lines where no block is open and parses the pieces on the shared thread pool
+            static std::vector<Statement> parse_in_parallel(const std::shared_ptr<const Lines>& script);
+
         private:
             
-            static std::size_t line_no;
+            // every thread counts the lines of the piece it is parsing
+            static thread_local std::size_t line_no;
 
             Program parsed_program;
     };
@@ -0,0 +1,155 @@
+#ifndef _RUNTIME_HPP_
+#define _RUNTIME_HPP_
+
+#include "Interpreter.hpp"
+#include "Jit.hpp"
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+namespace gvl
+{
+    // Support library of the C++ sources produced by 'gvl --emit-cpp'. Control flow is compiled,
+    // every statement is executed by the same routine the Interpreter uses for it.
+    class Runtime
+    {
+        public:
+
+            // true when a return statement left the block, which then leaves the enclosing blocks up to the function
+            using BlockFunc = bool (*)(Runtime&, Program::StmtContainer&);
+
+            class Loop
+            {
+                public:
+
+                    Loop(Runtime& runtime, const Statement& stmt)
+                        : runtime(runtime), stmt(stmt), hot_loop(runtime.scope(), stmt)
+                    {}
+
+                    bool next();
+
+                private:
+
+                    Runtime& runtime;
+                    const Statement& stmt;
+                    Jit::HotLoop hot_loop;
+                    bool started=false;
+            };
+
+            class Lines
+            {
+                public:
+
+                    Lines(Runtime& runtime, const Statement& stmt)
+                        : runtime(runtime), stmt(stmt), reader(Interpreter::open_lines(runtime.at(stmt), stmt))
+                    {}
+
+                    bool next();
+
+                private:
+
+                    Runtime& runtime;
+                    const Statement& stmt;
+                    LineReader reader;
+            };
+
+            class Yields
+            {
+                public:
+
+                    Yields(Runtime& runtime, const Statement& stmt)
+                        : runtime(runtime), stmt(stmt), generator(runtime.open_generator(stmt))
+                    {}
+
+                    bool next();
+
+                private:
+
+                    Runtime& runtime;
+                    const Statement& stmt;
+                    Generator generator;
+            };
+
+        public:
+
+            Runtime(int argc, char** argv);
+
+            inline void init(const Statement& stmt) { Interpreter::execute_init(at(stmt), stmt); }
+
+            inline void array_init(const Statement& stmt) { Interpreter::execute_array_init(at(stmt), stmt); }
+
+            inline void array_append(const Statement& stmt) { Interpreter::execute_array_append(at(stmt), stmt); }
+
+            inline void array_pop(const Statement& stmt) { Interpreter::execute_array_pop(at(stmt), stmt); }
+
+            inline void array_set(const Statement& stmt) { Interpreter::execute_array_set(at(stmt), stmt); }
+
+            inline void array_save(const Statement& stmt) { Interpreter::execute_array_save(at(stmt), stmt); }
+
+            inline void array_sort(const Statement& stmt) { Interpreter::execute_array_sort(at(stmt), stmt); }
+
+            inline void assign(const Statement& stmt) { Interpreter::execute_assign(at(stmt), stmt); }
+
+            inline void print(const Statement& stmt) { Interpreter::execute_print_related(at(stmt), stmt); }
+
+            inline void read(const Statement& stmt) { Interpreter::execute_read_related(at(stmt), stmt); }
+
+            inline void pfor(const Statement& stmt) { Interpreter::execute_pfor(at(stmt), stmt); }
+
+            inline void spawn(const Statement& stmt) { Interpreter::execute_spawn(at(stmt), stmt); }
+
+            inline void await(const Statement& stmt) { Interpreter::execute_await(at(stmt), stmt); }
+
+            inline void channel(const Statement& stmt) { Interpreter::execute_channel_related(at(stmt), stmt); }
+
+            inline void dict(const Statement& stmt) { Interpreter::execute_dict_related(at(stmt), stmt); }
+
+            inline bool condition(const Statement& stmt) { return Interpreter::evaluate_condition(at(stmt), stmt); }
+
+            void enter_scope();
+
+            void leave_scope();
+
+            void define(Statement& stmt, BlockFunc body);
+
+            void call(const Statement& stmt);
+
+            inline bool in_function() const { return calls_depth > 0; }
+
+            void finish() const;
+
+            // runs the top-level block and prints the variables it leaves, like gvl does; a script that fails is
+            // reported on stderr as gvl reports it, returns the exit status
+            int run(BlockFunc block, Program::StmtContainer& statements);
+
+        private:
+
+            inline Interpreter& scope() { return *scopes.back(); }
+
+            // the scope stmt runs in, errors are reported at its line
+            inline Interpreter& at(const Statement& stmt)
+            {
+                this->line_no = stmt.line_no;
+                return scope();
+            }
+
+            inline Generator open_generator(const Statement& stmt)
+            {
+                this->line_no = stmt.line_no;
+                return Interpreter::open_generator(scope(), stmt);
+            }
+
+        private:
+
+            std::array<Token, args_max_num> args;
+            std::vector<std::unique_ptr<Interpreter>> scopes;
+            std::unordered_map<TokenSv, std::pair<Statement*, BlockFunc>> functions;
+            std::size_t activations_no=0;
+            std::size_t calls_depth=0;
+            std::size_t line_no=0;
+    };
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef _SCRIPT_HPP_
+#define _SCRIPT_HPP_
+
+#include "Parser.hpp"
+#include "Interpreter.hpp"
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <iostream>
+
+
+namespace gvl
+{
+    // A parsed gvl script. It is never modified by running it, so it can be compiled
+    // once and shared by any number of Executions.
+    class Script
+    {
+        public:
+
+            // both throw Parser::ParseTimeError, function bodies included
+            static Script from_source(const std::string& source);
+
+            static Script from_file(const std::string& file_name);
+
+            inline const Program& get_program() const { return *program; }
+
+        private:
+
+            friend class Execution;
+
+            explicit Script(const Program& parsed_program)
+                : program(std::make_shared<const Program>(parsed_program))
+            {}
+
+            std::shared_ptr<const Program> program;
+    };
+
+    // One run of a Script with its own arguments, host injected variables and output. Every run
+    // gets functions, tasks and channels of its own and its variables live on the calling thread,
+    // so runs from several threads proceed in parallel; a thread runs one Execution at a time.
+    class Execution
+    {
+        public:
+
+            explicit Execution(const Script& script)
+                : program(script.program)
+            {}
+
+            Execution& set_args(const std::vector<Token>& args);
+
+            // injected variables exist before the first statement runs, so a 'var' of the same name keeps them
+            Execution& set_variable(const Token& name, const Token& value);
+
+            Execution& set_array(const Token& name, const std::vector<Token>& elements);
+
+            Execution& set_input(std::istream& in);
+
+            // print statements write into get_output() instead of std::cout
+            Execution& capture_output();
+
+            // limits of this run alone, 0 leaves a limit off; see Budget
+            Execution& set_max_statements(std::uint64_t value);
+
+            Execution& set_max_time(std::uint64_t milliseconds);
+
+            Execution& set_max_cpu_time(std::uint64_t milliseconds);
+
+            Execution& set_max_memory(std::uint64_t bytes);
+
+            // throws Interpreter::RunTimeError when the script fails, its bodies were all parsed by from_source/from_file
+            void run();
+
+            inline const std::string& get_output() const { return output; }
+
+            inline bool has_variable(const Token& name) const { return results.contains(name); }
+
+            // throw std::out_of_range for unknown variables
+            const VarLike& get_variable(const Token& name) const;
+
+            long long get_int(const Token& name) const;
+
+            double get_double(const Token& name) const;
+
+            const Token& get_string(const Token& name) const;
+
+            std::vector<Token> get_array(const Token& name) const;
+
+        private:
+
+            std::shared_ptr<const Program> program;
+            std::array<Token, args_max_num> args;
+            std::vector<std::pair<Token, VarLike>> injected;
+            std::istream* input=&std::cin;
+            bool capture=false;
+            Budget::Limits limits;
+            std::string output;
+            std::unordered_map<Token, VarLike> results;
+    };
+}
+
+#endif
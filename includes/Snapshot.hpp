@@ -0,0 +1,39 @@
+#ifndef _SNAPSHOT_HPP_
+#define _SNAPSHOT_HPP_
+
+#include "basic_types.hpp"
+#include <string>
+#include <cstdint>
+
+
+namespace gvl
+{
+    // Variables of a script at its top-level 'checkpoint' statement, kept in a binary image. A run given a file
+    // to save to writes the image when it passes the checkpoint and goes on; a run given an image to load drops
+    // the statements before the checkpoint, function definitions aside, and starts with the variables read from
+    // the mapped image instead. An image is only accepted by the script whose statements before the checkpoint
+    // it was taken of. Tasks, channels and memoized results are not kept.
+    class Snapshot
+    {
+        public:
+
+            static inline void set_save_file(const std::string& file_name) { save_file = file_name; }
+
+            static inline void set_load_file(const std::string& file_name) { load_file = file_name; }
+
+            // called on the parsed program before it is optimized; throws std::runtime_error when a snapshot
+            // is asked for and the script has no checkpoint, or the image is damaged or of another script
+            static void prepare(Program& program);
+
+            // the checkpoint statement, saves the current variables when a save file was given
+            static void checkpoint();
+
+        private:
+
+            static std::string save_file;
+            static std::string load_file;
+            static std::uint64_t script_key;
+    };
+}
+
+#endif
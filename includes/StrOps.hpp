@@ -0,0 +1,33 @@
+#ifndef _STR_OPS_HPP_
+#define _STR_OPS_HPP_
+
+#include "basic_types.hpp"
+#include <cstddef>
+#include <vector>
+
+
+namespace gvl
+{
+    // Substring search over string values. Candidates are found a block of text at a time by comparing
+    // every position against the first and the last byte of the needle with AVX2 (32 bytes) or SSE2
+    // (16 bytes) instructions, picked once by the CPU the process runs on, and only the positions where
+    // both match are compared in full. Other targets use the library search.
+    class StrOps
+    {
+        public:
+
+            // position of the first needle at or after from, text.size() when there is none; an empty needle is found at from
+            static std::size_t find(TokenSv text, TokenSv needle, std::size_t from=0);
+
+            // occurrences that do not overlap, counted from the left; 0 for an empty needle
+            static std::size_t count(TokenSv text, TokenSv needle);
+
+            // the non-empty pieces between separators, an empty separator splits text into its characters
+            static std::vector<Token> split(TokenSv text, TokenSv separator);
+
+            // every occurrence of from replaced by to, from the left and without overlaps
+            static Token replace(TokenSv text, TokenSv from, TokenSv to);
+    };
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef _THREAD_POOL_HPP_
+#define _THREAD_POOL_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+
+namespace gvl
+{
+    // Work-stealing pool: every worker pops tasks from the back of its own queue and steals
+    // from the front of the others' queues when it runs dry. A thread waiting for a
+    // parallel_for() runs that loop's chunks itself, so nested parallel loops cannot deadlock.
+    // A worker blocked on something else (a task, a channel) is stood in for by a spare
+    // thread while it waits, so the tasks it waits for still get to run.
+    class ThreadPool
+    {
+        public:
+
+            using Task = std::function<void()>;
+
+            // body(begin, end, chunk) is called for consecutive, non-overlapping chunks of [0, n)
+            using ChunkBody = std::function<void(std::size_t, std::size_t, std::size_t)>;
+
+            explicit ThreadPool(std::size_t threads);
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            ~ThreadPool();
+
+            // rethrows the first exception thrown by body, after every chunk has finished
+            void parallel_for(std::size_t n, std::size_t chunks, const ChunkBody& body);
+
+            void submit(Task task);
+
+            // waits until done() holds, done() is polled
+            void block_until(const std::function<bool()>& done);
+
+            inline std::size_t get_threads_no() const { return workers.size(); }
+
+            // lazily created pool shared by the whole process
+            static ThreadPool& shared();
+
+            // must be called before the first shared() to take effect, 0 means one thread per core
+            static inline void set_shared_threads_no(std::size_t threads) { shared_threads_no = threads; }
+
+        private:
+
+            struct QueuedTask
+            {
+                Task task;
+                const void* group=nullptr;
+            };
+
+            struct WorkerQueue
+            {
+                std::mutex mutex;
+                std::deque<QueuedTask> tasks;
+            };
+
+            void submit(Task task, const void* group);
+
+            // group == nullptr runs any task, otherwise only the tasks submitted with that group
+            bool try_run_one(const void* group=nullptr);
+
+            void worker_loop(std::size_t idx);
+
+            void spare_loop();
+
+        private:
+
+            static std::size_t shared_threads_no;
+
+            std::vector<std::unique_ptr<WorkerQueue>> queues;
+            std::vector<std::thread> workers;
+            std::vector<std::thread> spares;
+            std::atomic<std::size_t> queued=0;
+            std::atomic<std::size_t> next_queue=0;
+            std::size_t blocked=0;
+            std::size_t active_spares=0;
+            std::mutex sleep_mutex;
+            std::condition_variable wake_up;
+            bool stop=false;
+    };
+}
+
+#endif
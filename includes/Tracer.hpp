@@ -0,0 +1,66 @@
+#ifndef _TRACER_HPP_
+#define _TRACER_HPP_
+
+#include "basic_types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <string>
+
+
+namespace gvl
+{
+    // Collects spans of blocks, calls and I/O statements and writes them as Chrome trace events,
+    // which chrome://tracing and Perfetto open. Every thread records into a ring buffer of its own
+    // without locking, once full the oldest spans are overwritten. A span is recorded when it ends.
+    class Tracer
+    {
+        public:
+
+            static constexpr std::size_t buffer_capacity = 1 << 16;    // spans kept per thread
+
+            // spans are only recorded after this, before any thread starts recording
+            static void enable();
+
+            static inline bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+            // nanoseconds since enable()
+            static std::uint64_t now();
+
+            // category has to be a literal, name is copied
+            static void record(const char* category, TokenSv name, std::size_t line_no, std::uint64_t begin,
+                std::size_t iterations=1);
+
+            // every recording thread has to be idle, throws std::runtime_error if the file can not be written
+            static void write(const std::string& file_name);
+
+            // records a span from its construction to its destruction, does nothing while tracing is off
+            class Span
+            {
+                public:
+
+                    Span(const char* category, TokenSv name, std::size_t line_no);
+
+                    Span(const Span&) = delete;
+                    Span& operator=(const Span&) = delete;
+
+                    ~Span();
+
+                    inline void set_iterations(std::size_t n) { iterations = n; }
+
+                private:
+
+                    const char* category;
+                    TokenSv name;
+                    std::size_t line_no;
+                    std::uint64_t begin=0;
+                    std::size_t iterations=1;
+            };
+
+        private:
+
+            static std::atomic<bool> enabled;
+    };
+}
+
+#endif
@@ -6,6 +6,7 @@
 #include <sstream>
 #include <vector>
 #include <array>
+#include <memory>
 
 
 namespace gvl
@@ -35,9 +36,25 @@ namespace gvl
         ARRAY_APPEND,
         ARRAY_SET,
         ARRAY_POP,
+        ARRAY_SAVE,
         CALL_FUNC,
         DEF_FUNC,
         RETURN,
+        PFOR,
+        SPAWN,
+        AWAIT,
+        CHANNEL_INIT,
+        CHANNEL_SEND,
+        CHANNEL_RECV,
+        CHANNEL_CLOSE,
+        FOR_LINES,
+        DICT_INIT,
+        DICT_SET,
+        DICT_REMOVE,
+        YIELD,
+        FOR_GENERATOR,
+        ARRAY_SORT,
+        CHECKPOINT,
         NONE
     };
 
@@ -48,6 +65,15 @@ namespace gvl
         Token right;
     };
 
+    // lines [begin, end) of a script, the first of which is line line_no
+    struct SourceRange
+    {
+        std::shared_ptr<const std::vector<std::string>> lines;
+        std::size_t begin;
+        std::size_t end;
+        std::size_t line_no;
+    };
+
     struct Statement
     {
         StatementType type;
@@ -55,6 +81,8 @@ namespace gvl
         Expression expression;
         std::vector<Statement> main_body;
         std::vector<Statement> second_body;
+        std::size_t line_no=0;
+        std::shared_ptr<const SourceRange> unparsed_body;    // set until a lazily parsed function body is parsed
     };
 
     struct Program
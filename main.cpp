@@ -3,42 +3,146 @@
 #include <vector>
 #include <array>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <ranges>
 #include <algorithm>
 #include "includes/Parser.hpp"
 #include "includes/Interpreter.hpp"
+#include "includes/Jit.hpp"
+#include "includes/CppEmitter.hpp"
+#include "includes/ThreadPool.hpp"
+#include "includes/Tracer.hpp"
+#include "includes/Optimizer.hpp"
+#include "includes/Snapshot.hpp"
+#include "includes/Budget.hpp"
 #include <map>
 
 
 int main(int argc, char** argv)
 {
-    assert(argc >= 2 && argc - 2 <= gvl::args_max_num);
+    // the streams buffer on their own, so a line of stdin can be handed out as soon as it arrives
+    std::ios::sync_with_stdio(false);
+
+    int arg_idx = 1;
+    bool emit_cpp = false;
+    bool memo_stats = false;
+    std::string trace_file;
+    gvl::Budget::Limits limits;
+
+    for (; arg_idx < argc && std::string_view(argv[arg_idx]).starts_with("--"); ++arg_idx)
+    {
+        const std::string_view option(argv[arg_idx]);
+
+        if (option == "--emit-cpp")
+            emit_cpp = true;
+        else if (option == "--no-jit")
+            gvl::Jit::set_enabled(false);
+        else if (option == "--jit-threshold" && arg_idx + 1 < argc)
+            gvl::Jit::set_hotness_threshold(std::stoul(argv[++arg_idx]));
+        else if (option == "--threads" && arg_idx + 1 < argc)
+            gvl::ThreadPool::set_shared_threads_no(std::stoul(argv[++arg_idx]));
+        else if (option == "--memo-size" && arg_idx + 1 < argc)
+            gvl::MemoCache::set_default_capacity(std::stoul(argv[++arg_idx]));
+        else if (option == "--memo-stats")
+            memo_stats = true;
+        else if (option == "--trace" && arg_idx + 1 < argc)
+            trace_file = argv[++arg_idx];
+        else if (option == "--no-opt")
+            gvl::Optimizer::set_enabled(false);
+        else if (option == "--opt-report")
+            gvl::Optimizer::set_reporting(true);
+        else if (option == "--inline-size" && arg_idx + 1 < argc)
+            gvl::Optimizer::set_inline_size(std::stoul(argv[++arg_idx]));
+        else if (option == "--save-snapshot" && arg_idx + 1 < argc)
+            gvl::Snapshot::set_save_file(argv[++arg_idx]);
+        else if (option == "--load-snapshot" && arg_idx + 1 < argc)
+            gvl::Snapshot::set_load_file(argv[++arg_idx]);
+        else if (option == "--max-statements" && arg_idx + 1 < argc)
+            limits.statements = std::stoull(argv[++arg_idx]);
+        else if (option == "--max-time" && arg_idx + 1 < argc)
+            limits.time = std::stoull(argv[++arg_idx]);
+        else if (option == "--max-cpu-time" && arg_idx + 1 < argc)
+            limits.cpu_time = std::stoull(argv[++arg_idx]);
+        else if (option == "--max-memory" && arg_idx + 1 < argc)
+            limits.memory = std::stoull(argv[++arg_idx]) << 20;
+        else
+        {
+            std::cout << "unknown option: " << option << "\n";
+            return 1;
+        }
+    }
+
+    assert(argc - arg_idx >= 1 && argc - arg_idx - 1 <= gvl::args_max_num);
 
     std::vector<char> buffer;
-    std::istringstream iss(gvl::Parser::read_file_content(argv[1], buffer));
+    std::istringstream iss(gvl::Parser::read_file_content(argv[arg_idx], buffer));
     
     std::vector<std::string> lines(gvl::Parser::split_to_lines(iss));
     
     std::array<std::string, gvl::args_max_num> args;
     
-    for (int i = 2; i < argc; ++i)
-        args[i] = argv[i];
+    for (int i = arg_idx + 1; i < argc; ++i)
+        args[i - arg_idx - 1] = argv[i];
 
     try 
     {
         gvl::Parser parser(lines, &args);
+        gvl::Program program(parser.get_parsed_program());
+
+        try
+        {
+            gvl::Snapshot::prepare(program);
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cout << e.what() << "\n";
+            return 1;
+        }
+
+        gvl::Optimizer::optimize(program);
 
-        gvl::Interpreter interpreter(parser.get_parsed_program());
+        if (emit_cpp)
+        {
+            std::cout << gvl::CppEmitter::emit(program, argv[arg_idx]);
+            return 0;
+        }
+
+        gvl::Interpreter interpreter(program);
+
+        if (!trace_file.empty())
+            gvl::Tracer::enable();
+
+        if (limits.any())
+            gvl::Interpreter::start_budget(limits);
 
         interpreter.execute_program();
 
         interpreter.print_vars();
 
+        if (memo_stats)
+            gvl::Interpreter::print_memo_stats(std::cerr);
+
+        if (!trace_file.empty())
+            gvl::Tracer::write(trace_file);
+
     }
     catch (const gvl::Parser::ParseTimeError& e) 
     {
+        // what --emit-cpp writes to stdout is compiled, an error must not end up there
+        if (emit_cpp)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+
         std::cout << e.what() << "\n"; 
     }
+    catch (const gvl::Interpreter::RunTimeError& e)
+    {
+        std::cout << std::flush;
+        std::cerr << "runtime error: " << e.what() << "\n";
+        return 1;
+    }
 
 }
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "../includes/ArrayIO.hpp"
+#include "../includes/ThreadPool.hpp"
+#include "../includes/MappedFile.hpp"
+#include <cstring>
+#include <cstdint>
+#include <charconv>
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <stdexcept>
+
+
+// below this many elements converting on the calling thread is cheaper than waking the pool
+static constexpr std::size_t parallel_threshold = 1 << 16;
+
+namespace
+{
+    enum class Format
+    {
+        I32,
+        I64,
+        F32,
+        F64,
+        CSV
+    };
+}
+
+static Format parse_format(const std::string& format, std::size_t& column)
+{
+    column = 0;
+
+    if (format == "i32")
+        return Format::I32;
+    if (format == "i64")
+        return Format::I64;
+    if (format == "f32")
+        return Format::F32;
+    if (format == "f64")
+        return Format::F64;
+    if (format == "csv")
+        return Format::CSV;
+
+    if (format.starts_with("csv:"))
+    {
+        const char* first = format.data() + 4;
+        const char* last = format.data() + format.size();
+
+        if (first != last && std::from_chars(first, last, column).ptr == last)
+            return Format::CSV;
+    }
+
+    throw std::runtime_error("unknown array format '" + format + "'");
+}
+
+static void for_each_chunk(std::size_t n, const gvl::ThreadPool::ChunkBody& body)
+{
+    if (n < parallel_threshold)
+    {
+        body(0, n, 0);
+        return;
+    }
+
+    gvl::ThreadPool& pool = gvl::ThreadPool::shared();
+    pool.parallel_for(n, 4 * pool.get_threads_no(), body);
+}
+
+template <typename T>
+static T read_little_endian(const char* bytes)
+{
+    char buffer[sizeof(T)];
+    std::memcpy(buffer, bytes, sizeof(T));
+
+    if constexpr (std::endian::native == std::endian::big)
+        std::reverse(buffer, buffer + sizeof(T));
+
+    T value;
+    std::memcpy(&value, buffer, sizeof(T));
+    return value;
+}
+
+template <typename T>
+static void write_little_endian(char* bytes, T value)
+{
+    std::memcpy(bytes, &value, sizeof(T));
+
+    if constexpr (std::endian::native == std::endian::big)
+        std::reverse(bytes, bytes + sizeof(T));
+}
+
+// fixed notation, exponents would make the interpreter deduce a string
+template <typename T>
+static gvl::Token format_number(T value)
+{
+    char buffer[512];
+    std::to_chars_result result;
+
+    if constexpr (std::is_floating_point_v<T>)
+        result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed);
+    else
+        result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+
+    return gvl::Token(buffer, result.ptr);
+}
+
+template <typename T>
+static T parse_number(const gvl::Token& token)
+{
+    const char* first = token.data();
+    const char* last = token.data() + token.size();
+    T value = T();
+
+    if (std::from_chars(first, last, value).ptr == last && first != last)
+        return value;
+
+    // integers computed by the interpreter may carry a zero fraction, e.g. 4.000000
+    double fallback = 0;
+    if constexpr (std::is_integral_v<T>)
+    {
+        if (std::from_chars(first, last, fallback).ptr == last && first != last)
+            return static_cast<T>(fallback);
+    }
+
+    throw std::runtime_error("array element '" + token + "' is not a number");
+}
+
+template <typename T>
+static std::vector<gvl::Token> load_binary(const gvl::MappedFile& file)
+{
+    if (file.get_size() % sizeof(T) != 0)
+        throw std::runtime_error("file size is not a multiple of the element size");
+
+    std::vector<gvl::Token> elements(file.get_size() / sizeof(T));
+
+    for_each_chunk(elements.size(), [&elements, &file](std::size_t begin, std::size_t end, std::size_t)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+            elements[i] = format_number(read_little_endian<T>(file.begin() + i * sizeof(T)));
+    });
+
+    return elements;
+}
+
+template <typename T>
+static void save_binary(const gvl::ArrayStorage& elements, std::ofstream& out)
+{
+    std::vector<char> bytes(elements.size() * sizeof(T));
+
+    for_each_chunk(elements.size(), [&elements, &bytes](std::size_t begin, std::size_t end, std::size_t)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+            write_little_endian(bytes.data() + i * sizeof(T), parse_number<T>(elements[i]));
+    });
+
+    out.write(bytes.data(), bytes.size());
+}
+
+static std::string_view trim(std::string_view field)
+{
+    while (!field.empty() && (field.front() == ' ' || field.front() == '\t'))
+        field.remove_prefix(1);
+    while (!field.empty() && (field.back() == ' ' || field.back() == '\t' || field.back() == '\r'))
+        field.remove_suffix(1);
+
+    if (field.size() >= 2 && field.front() == '"' && field.back() == '"')
+        field = field.substr(1, field.size() - 2);
+
+    return field;
+}
+
+static std::vector<gvl::Token> load_csv(const gvl::MappedFile& file, std::size_t column)
+{
+    std::vector<gvl::Token> elements;
+    const std::string_view content(file.begin(), file.get_size());
+
+    for (std::size_t pos = 0; pos < content.size();)
+    {
+        std::size_t eol = content.find('\n', pos);
+        if (eol == std::string_view::npos)
+            eol = content.size();
+
+        std::string_view row = content.substr(pos, eol - pos);
+        pos = eol + 1;
+
+        for (std::size_t i = 0; i < column && !row.empty(); ++i)
+        {
+            const std::size_t comma = row.find(',');
+            row = comma == std::string_view::npos ? std::string_view() : row.substr(comma + 1);
+        }
+
+        const std::string_view field = trim(row.substr(0, row.find(',')));
+
+        if (!field.empty())
+            elements.emplace_back(field);
+    }
+
+    return elements;
+}
+
+std::vector<gvl::Token> gvl::ArrayIO::load(const std::string& file_name, const std::string& format)
+{
+    std::size_t column;
+    const Format fmt = parse_format(format, column);
+    const gvl::MappedFile file(file_name);
+
+    switch (fmt)
+    {
+        case Format::I32:
+            return load_binary<std::int32_t>(file);
+        case Format::I64:
+            return load_binary<std::int64_t>(file);
+        case Format::F32:
+            return load_binary<float>(file);
+        case Format::F64:
+            return load_binary<double>(file);
+        default:
+            return load_csv(file, column);
+    }
+}
+
+void gvl::ArrayIO::save(const ArrayStorage& elements, const std::string& file_name, const std::string& format)
+{
+    std::size_t column;
+    const Format fmt = parse_format(format, column);
+    std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+
+    if (!out)
+        throw std::runtime_error("can not open '" + file_name + "'");
+
+    switch (fmt)
+    {
+        case Format::I32:
+            save_binary<std::int32_t>(elements, out);
+            break;
+        case Format::I64:
+            save_binary<std::int64_t>(elements, out);
+            break;
+        case Format::F32:
+            save_binary<float>(elements, out);
+            break;
+        case Format::F64:
+            save_binary<double>(elements, out);
+            break;
+        default:
+        {
+            std::string content;
+            for (const Token& element : elements)
+            {
+                content += element;
+                content += '\n';
+            }
+            out.write(content.data(), content.size());
+            break;
+        }
+    }
+
+    if (!out)
+        throw std::runtime_error("can not write '" + file_name + "'");
+}
@@ -0,0 +1,175 @@
+#include "../includes/ArrayOps.hpp"
+#include "../includes/ThreadPool.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <unordered_set>
+
+
+// below this many elements sorting on the calling thread is cheaper than waking the pool
+static constexpr std::size_t parallel_threshold = 1 << 16;
+
+namespace
+{
+    // an element with the number it holds, elements are sorted by reference and copied once at the end
+    struct Keyed
+    {
+        double number;
+        const gvl::Token* token;
+    };
+}
+
+
+static bool parse_number(gvl::TokenSv token, double& number)
+{
+    if (token.empty())
+        return false;
+
+    const auto [ ptr, ec ] = std::from_chars(token.data(), token.data() + token.size(), number);
+    return ec == std::errc() && ptr == token.data() + token.size() && std::isfinite(number);
+}
+
+static bool all_numbers(const gvl::ArrayStorage& elements, std::vector<Keyed>& keyed)
+{
+    keyed.reserve(elements.size());
+
+    bool numbers = true;
+    for (const gvl::Token& element : elements)
+    {
+        Keyed entry{ 0, &element };
+        numbers = numbers && parse_number(element, entry.number);
+        keyed.push_back(entry);
+    }
+
+    return numbers;
+}
+
+// a power of two of sorted runs is merged pairwise, every round halving their number
+template <typename Less>
+static void parallel_stable_sort(std::vector<Keyed>& items, Less less)
+{
+    const std::size_t n = items.size();
+
+    if (n < parallel_threshold)
+    {
+        std::stable_sort(items.begin(), items.end(), less);
+        return;
+    }
+
+    gvl::ThreadPool& pool = gvl::ThreadPool::shared();
+
+    std::size_t runs = 1;
+    while (runs < 2 * pool.get_threads_no() && n / (2 * runs) >= parallel_threshold / 4)
+        runs *= 2;
+
+    std::vector<std::size_t> bounds(runs + 1);
+    for (std::size_t r = 0; r <= runs; ++r)
+        bounds[r] = n * r / runs;
+
+    pool.parallel_for(runs, runs, [&items, &bounds, &less](std::size_t begin, std::size_t end, std::size_t)
+    {
+        for (std::size_t r = begin; r < end; ++r)
+            std::stable_sort(items.begin() + bounds[r], items.begin() + bounds[r + 1], less);
+    });
+
+    std::vector<Keyed> merged(n);
+
+    for (std::size_t width = 1; width < runs; width *= 2)
+    {
+        const std::size_t pairs = runs / (2 * width);
+
+        pool.parallel_for(pairs, pairs, [&](std::size_t begin, std::size_t end, std::size_t)
+        {
+            for (std::size_t p = begin; p < end; ++p)
+            {
+                const std::size_t low = bounds[2 * p * width];
+                const std::size_t middle = bounds[(2 * p + 1) * width];
+                const std::size_t high = bounds[(2 * p + 2) * width];
+
+                std::merge(items.begin() + low, items.begin() + middle, items.begin() + middle, items.begin() + high,
+                    merged.begin() + low, less);
+            }
+        });
+
+        items.swap(merged);
+    }
+}
+
+void gvl::ArrayOps::sort(ArrayStorage& elements, bool descending)
+{
+    std::vector<Keyed> keyed;
+
+    if (all_numbers(elements, keyed))
+    {
+        if (descending)
+            parallel_stable_sort(keyed, [](const Keyed& lhs, const Keyed& rhs) { return lhs.number > rhs.number; });
+        else
+            parallel_stable_sort(keyed, [](const Keyed& lhs, const Keyed& rhs) { return lhs.number < rhs.number; });
+    }
+    else if (descending)
+        parallel_stable_sort(keyed, [](const Keyed& lhs, const Keyed& rhs) { return *lhs.token > *rhs.token; });
+    else
+        parallel_stable_sort(keyed, [](const Keyed& lhs, const Keyed& rhs) { return *lhs.token < *rhs.token; });
+
+    std::vector<Token> sorted;
+    sorted.reserve(keyed.size());
+
+    for (const Keyed& entry : keyed)
+        sorted.push_back(*entry.token);
+
+    elements = ArrayStorage(std::move(sorted));
+}
+
+std::size_t gvl::ArrayOps::bsearch(const ArrayStorage& elements, TokenSv value)
+{
+    double number = 0;
+    ArrayStorage::const_iterator found;
+
+    if (parse_number(value, number))
+    {
+        // an element that is not a number can only be in an array sorted as text, where it sorts after the digits
+        const auto before = [number](const Token& element)
+        {
+            double element_number = 0;
+            return parse_number(element, element_number) ? element_number < number : false;
+        };
+
+        found = std::partition_point(elements.begin(), elements.end(), before);
+
+        double found_number = 0;
+        if (found != elements.end() && parse_number(*found, found_number) && found_number == number)
+            return found - elements.begin();
+    }
+    else
+    {
+        found = std::lower_bound(elements.begin(), elements.end(), value,
+            [](const Token& element, TokenSv target) { return TokenSv(element) < target; });
+
+        if (found != elements.end() && *found == value)
+            return found - elements.begin();
+    }
+
+    return elements.size();
+}
+
+std::vector<gvl::Token> gvl::ArrayOps::unique(const ArrayStorage& elements)
+{
+    std::vector<Token> result;
+    std::unordered_set<Token> seen;
+    seen.reserve(elements.size());
+
+    for (const Token& element : elements)
+    {
+        double number = 0;
+        char buffer[64];
+
+        const bool repeat = parse_number(element, number)
+            ? !seen.emplace(buffer, std::to_chars(buffer, buffer + sizeof(buffer), number).ptr).second
+            : !seen.insert(element).second;
+
+        if (!repeat)
+            result.push_back(element);
+    }
+
+    return result;
+}
@@ -0,0 +1,89 @@
+#include "../includes/Budget.hpp"
+#include "../includes/Interpreter.hpp"
+#include <string>
+#include <ctime>
+#include <algorithm>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+
+thread_local gvl::Budget* gvl::Budget::active = nullptr;
+thread_local std::uint64_t gvl::Budget::pending_statements = 0;
+thread_local std::uint64_t gvl::Budget::pending_bytes = 0;
+
+
+// of every thread of the process, pool workers included
+static std::uint64_t cpu_milliseconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000 + static_cast<std::uint64_t>(ts.tv_nsec) / 1000000;
+}
+
+// bytes the allocator has handed out and not got back, 0 where that is unknown
+static std::uint64_t heap_in_use()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    const struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+static void exceeded(const std::string& limit)
+{
+    throw gvl::Interpreter::RunTimeError(gvl::Interpreter::ErrorCode::LIMIT_EXCEEDED, limit + " limit exceeded");
+}
+
+gvl::Budget::Budget(const Limits& limits)
+    : limits(limits), batch(limits.statements > 0 ? std::min(check_interval, limits.statements) : check_interval),
+      started(std::chrono::steady_clock::now()), cpu_started(cpu_milliseconds()), memory_baseline(heap_in_use())
+{}
+
+void gvl::Budget::install(Budget* budget)
+{
+    if (active != nullptr)
+        active->statements.fetch_add(pending_statements, std::memory_order_relaxed);
+
+    pending_statements = 0;
+    pending_bytes = 0;
+    active = budget != nullptr && budget->limits.any() ? budget : nullptr;
+}
+
+std::uint64_t gvl::Budget::fuel()
+{
+    const Limits& limits = active->limits;
+
+    if (limits.statements == 0)
+        return native_interval;
+
+    const std::uint64_t executed = active->statements.load(std::memory_order_relaxed) + pending_statements;
+    return executed < limits.statements ? std::min(native_interval, limits.statements - executed) : 0;
+}
+
+void gvl::Budget::check()
+{
+    const Limits& limits = active->limits;
+    const std::uint64_t executed = active->statements.fetch_add(pending_statements, std::memory_order_relaxed) + pending_statements;
+    pending_statements = 0;
+    pending_bytes = 0;
+
+    if (limits.statements > 0 && executed > limits.statements)
+        exceeded("statement (" + std::to_string(limits.statements) + ")");
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - active->started);
+
+    if (limits.time > 0 && static_cast<std::uint64_t>(elapsed.count()) > limits.time)
+        exceeded("time (" + std::to_string(limits.time) + " ms)");
+
+    if (limits.cpu_time > 0 && cpu_milliseconds() - active->cpu_started > limits.cpu_time)
+        exceeded("cpu time (" + std::to_string(limits.cpu_time) + " ms)");
+
+    const std::uint64_t memory = heap_in_use();
+
+    if (limits.memory > 0 && memory > active->memory_baseline && memory - active->memory_baseline > limits.memory)
+        exceeded("memory (" + std::to_string(limits.memory >> 20) + " MiB)");
+}
@@ -0,0 +1,71 @@
+#include "../includes/Channel.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+
+static std::mutex registry_mutex;
+static std::unordered_map<gvl::Token, std::shared_ptr<gvl::Channel>> registry;
+static std::size_t channels_no = 0;
+
+
+gvl::Channel::Channel(std::size_t capacity)
+    : capacity(std::max<std::size_t>(capacity, 1))
+{}
+
+bool gvl::Channel::try_send(const Token& value)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (this->closed)
+        throw std::runtime_error("send on a closed channel");
+
+    if (this->values.size() == this->capacity)
+        return false;
+
+    this->values.push_back(value);
+    return true;
+}
+
+gvl::Channel::Receive gvl::Channel::try_receive(Token& value)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (this->values.empty())
+        return this->closed ? Receive::CLOSED : Receive::EMPTY;
+
+    value = std::move(this->values.front());
+    this->values.pop_front();
+
+    return Receive::VALUE;
+}
+
+void gvl::Channel::close()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->closed = true;
+}
+
+gvl::Token gvl::Channel::create(std::size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    const Token handle = "channel#" + std::to_string(++channels_no);
+    registry[handle] = std::make_shared<Channel>(capacity);
+
+    return handle;
+}
+
+std::shared_ptr<gvl::Channel> gvl::Channel::find(TokenSv handle)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    const auto it = registry.find(Token(handle));
+
+    return it != registry.end() ? it->second : nullptr;
+}
+
+void gvl::Channel::forget(TokenSv handle)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.erase(Token(handle));
+}
@@ -0,0 +1,288 @@
+#include "../includes/CppEmitter.hpp"
+#include "../includes/Parser.hpp"
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+
+
+static const std::string& statement_type_name(gvl::StatementType type)
+{
+    static std::map<gvl::StatementType, std::string> strings;
+    if (strings.size() == 0)
+    {
+        #define INSERT_ELEMENT(p) strings[p] = #p
+                INSERT_ELEMENT(gvl::StatementType::READCHAR);
+                INSERT_ELEMENT(gvl::StatementType::READINT);
+                INSERT_ELEMENT(gvl::StatementType::READFLOAT);
+                INSERT_ELEMENT(gvl::StatementType::READSTR);
+                INSERT_ELEMENT(gvl::StatementType::READLN);
+                INSERT_ELEMENT(gvl::StatementType::PRINT);
+                INSERT_ELEMENT(gvl::StatementType::PRINTLN);
+                INSERT_ELEMENT(gvl::StatementType::INIT);
+                INSERT_ELEMENT(gvl::StatementType::CONST);
+                INSERT_ELEMENT(gvl::StatementType::ASSIGN);
+                INSERT_ELEMENT(gvl::StatementType::IF);
+                INSERT_ELEMENT(gvl::StatementType::ELSE);
+                INSERT_ELEMENT(gvl::StatementType::WHILE);
+                INSERT_ELEMENT(gvl::StatementType::BRACKET);
+                INSERT_ELEMENT(gvl::StatementType::ARRAY_INIT);
+                INSERT_ELEMENT(gvl::StatementType::ARRAY_APPEND);
+                INSERT_ELEMENT(gvl::StatementType::ARRAY_SET);
+                INSERT_ELEMENT(gvl::StatementType::ARRAY_POP);
+                INSERT_ELEMENT(gvl::StatementType::ARRAY_SAVE);
+                INSERT_ELEMENT(gvl::StatementType::ARRAY_SORT);
+                INSERT_ELEMENT(gvl::StatementType::CALL_FUNC);
+                INSERT_ELEMENT(gvl::StatementType::DEF_FUNC);
+                INSERT_ELEMENT(gvl::StatementType::RETURN);
+                INSERT_ELEMENT(gvl::StatementType::PFOR);
+                INSERT_ELEMENT(gvl::StatementType::SPAWN);
+                INSERT_ELEMENT(gvl::StatementType::AWAIT);
+                INSERT_ELEMENT(gvl::StatementType::CHANNEL_INIT);
+                INSERT_ELEMENT(gvl::StatementType::CHANNEL_SEND);
+                INSERT_ELEMENT(gvl::StatementType::CHANNEL_RECV);
+                INSERT_ELEMENT(gvl::StatementType::CHANNEL_CLOSE);
+                INSERT_ELEMENT(gvl::StatementType::FOR_LINES);
+                INSERT_ELEMENT(gvl::StatementType::DICT_INIT);
+                INSERT_ELEMENT(gvl::StatementType::DICT_SET);
+                INSERT_ELEMENT(gvl::StatementType::DICT_REMOVE);
+                INSERT_ELEMENT(gvl::StatementType::YIELD);
+                INSERT_ELEMENT(gvl::StatementType::FOR_GENERATOR);
+                INSERT_ELEMENT(gvl::StatementType::CHECKPOINT);
+                INSERT_ELEMENT(gvl::StatementType::NONE);
+        #undef INSERT_ELEMENT
+    }
+
+    return strings[type];
+}
+
+static std::string quote(const gvl::Token& token)
+{
+    std::ostringstream oss;
+    oss << '"';
+
+    for (const unsigned char c : token)
+    {
+        if (c == '"' || c == '\\')
+            oss << '\\' << c;
+        else if (c == '\n')
+            oss << "\\n";
+        else if (c == '\t')
+            oss << "\\t";
+        else if (c == '\r')
+            oss << "\\r";
+        else if (c < 0x20)
+            oss << '\\' << std::oct << std::setw(3) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        else
+            oss << c;
+    }
+
+    oss << '"';
+    return oss.str();
+}
+
+static void emit_statements(std::ostringstream& out, const gvl::Program::StmtContainer& stmts, std::size_t depth)
+{
+    const std::string indent(4 * depth, ' ');
+
+    for (const gvl::Statement& stmt : stmts)
+    {
+        out << indent << "gvl::Statement{ " << statement_type_name(stmt.type) << ", { ";
+
+        for (std::size_t i = 0; i < stmt.line.size(); ++i)
+            out << (i > 0 ? ", " : "") << quote(stmt.line[i]);
+
+        out << " }, { " << quote(stmt.expression.left) << ", " << quote(stmt.expression.middle) << ", "
+            << quote(stmt.expression.right) << " }, {";
+
+        if (!stmt.main_body.empty())
+        {
+            out << "\n";
+            emit_statements(out, stmt.main_body, depth + 1);
+            out << indent;
+        }
+
+        out << "}, {}, " << stmt.line_no << " },\n";
+    }
+}
+
+// a block of statements becomes one C++ function, nested blocks are emitted first
+static std::size_t emit_block(std::vector<std::string>& blocks, const gvl::Program::StmtContainer& stmts)
+{
+    using gvl::StatementType;
+
+    std::ostringstream body;
+
+    for (std::size_t i = 0; i < stmts.size(); ++i)
+    {
+        const gvl::Statement& stmt = stmts[i];
+        const std::string ref = "body[" + std::to_string(i) + "]";
+
+        switch (stmt.type)
+        {
+            case StatementType::INIT:
+            case StatementType::CONST:
+                body << "    rt.init(" << ref << ");\n";
+                break;
+            case StatementType::ARRAY_INIT:
+                body << "    rt.array_init(" << ref << ");\n";
+                break;
+            case StatementType::ARRAY_APPEND:
+                body << "    rt.array_append(" << ref << ");\n";
+                break;
+            case StatementType::ARRAY_POP:
+                body << "    rt.array_pop(" << ref << ");\n";
+                break;
+            case StatementType::ARRAY_SET:
+                body << "    rt.array_set(" << ref << ");\n";
+                break;
+            case StatementType::ARRAY_SAVE:
+                body << "    rt.array_save(" << ref << ");\n";
+                break;
+            case StatementType::ARRAY_SORT:
+                body << "    rt.array_sort(" << ref << ");\n";
+                break;
+            case StatementType::ASSIGN:
+                body << "    rt.assign(" << ref << ");\n";
+                break;
+            case StatementType::PRINT:
+            case StatementType::PRINTLN:
+                body << "    rt.print(" << ref << ");\n";
+                break;
+            case StatementType::READCHAR:
+            case StatementType::READINT:
+            case StatementType::READFLOAT:
+            case StatementType::READSTR:
+            case StatementType::READLN:
+                body << "    rt.read(" << ref << ");\n";
+                break;
+            case StatementType::CALL_FUNC:
+                body << "    rt.call(" << ref << ");\n";
+                break;
+            case StatementType::PFOR:
+                // iterations run on the interpreter's thread pool, the body stays interpreted
+                body << "    rt.pfor(" << ref << ");\n";
+                break;
+            case StatementType::FOR_LINES:
+            case StatementType::FOR_GENERATOR:
+            {
+                // a generator's own body runs in the interpreter, which can suspend it at its yields
+                const std::size_t id = emit_block(blocks, stmt.main_body);
+                const char* source = stmt.type == StatementType::FOR_LINES ? "Lines" : "Yields";
+                body << "    for (gvl::Runtime::" << source << " values(rt, " << ref << "); values.next();)\n    {\n"
+                     << "        rt.enter_scope();\n"
+                     << "        if (block_" << id << "(rt, " << ref << ".main_body))\n"
+                     << "            return rt.leave_scope(), true;\n"
+                     << "        rt.leave_scope();\n    }\n";
+                break;
+            }
+            case StatementType::YIELD:
+                // values of a generator run by a plain call are dropped
+                break;
+            case StatementType::SPAWN:
+                body << "    rt.spawn(" << ref << ");\n";
+                break;
+            case StatementType::AWAIT:
+                body << "    rt.await(" << ref << ");\n";
+                break;
+            case StatementType::CHANNEL_INIT:
+            case StatementType::CHANNEL_SEND:
+            case StatementType::CHANNEL_RECV:
+            case StatementType::CHANNEL_CLOSE:
+                body << "    rt.channel(" << ref << ");\n";
+                break;
+            case StatementType::DICT_INIT:
+            case StatementType::DICT_SET:
+            case StatementType::DICT_REMOVE:
+                body << "    rt.dict(" << ref << ");\n";
+                break;
+            case StatementType::DEF_FUNC:
+                body << "    rt.define(" << ref << ", block_" << emit_block(blocks, stmt.main_body) << ");\n";
+                break;
+            case StatementType::CHECKPOINT:
+                // snapshots are taken and restored by the interpreter only
+                break;
+            case StatementType::IF:
+            {
+                const std::size_t id = emit_block(blocks, stmt.main_body);
+                body << "    if (rt.condition(" << ref << "))\n    {\n"
+                     << "        rt.enter_scope();\n"
+                     << "        if (block_" << id << "(rt, " << ref << ".main_body))\n"
+                     << "            return rt.leave_scope(), true;\n"
+                     << "        rt.leave_scope();\n    }\n";
+                break;
+            }
+            case StatementType::WHILE:
+            {
+                const std::size_t id = emit_block(blocks, stmt.main_body);
+                body << "    for (gvl::Runtime::Loop loop(rt, " << ref << "); loop.next();)\n    {\n"
+                     << "        rt.enter_scope();\n"
+                     << "        if (block_" << id << "(rt, " << ref << ".main_body))\n"
+                     << "            return rt.leave_scope(), true;\n"
+                     << "        rt.leave_scope();\n    }\n";
+                break;
+            }
+            case StatementType::RETURN:
+                // leaves the function, like Interpreter::run(), outside of functions it only ends the block
+                body << "    return rt.in_function();\n";
+                i = stmts.size();
+                break;
+            default:
+                // statements without an executor end their block, exactly like Interpreter::run()
+                body << "    return false;\n";
+                i = stmts.size();
+                break;
+        }
+    }
+
+    body << "    return false;\n";
+
+    const std::size_t id = blocks.size();
+    std::ostringstream block;
+
+    block << "static bool block_" << id << "([[maybe_unused]] gvl::Runtime& rt, [[maybe_unused]] gvl::Program::StmtContainer& body)\n{\n"
+          << body.str() << "}\n";
+
+    blocks.push_back(block.str());
+    return id;
+}
+
+// the emitted program has no script to parse function bodies from later
+static void parse_function_bodies(gvl::Program::StmtContainer& stmts)
+{
+    for (gvl::Statement& stmt : stmts)
+    {
+        gvl::Parser::parse_function_body(stmt);
+        parse_function_bodies(stmt.main_body);
+    }
+}
+
+std::string gvl::CppEmitter::emit(const Program& parsed_program, const std::string& source_name)
+{
+    Program program(parsed_program);
+    parse_function_bodies(program.statements);
+
+    std::vector<std::string> blocks;
+    const std::size_t main_block = emit_block(blocks, program.statements);
+
+    std::ostringstream out;
+
+    out << "// generated by 'gvl --emit-cpp " << source_name << "', do not edit\n"
+        << "#include \"Runtime.hpp\"\n\n"
+        << "static gvl::Program::StmtContainer statements = {\n";
+
+    emit_statements(out, program.statements, 1);
+
+    out << "};\n\n";
+
+    for (const std::string& block : blocks)
+        out << block << "\n";
+
+    out << "int main(int argc, char** argv)\n{\n"
+        << "    gvl::Runtime rt(argc, argv);\n"
+        << "    return rt.run(block_" << main_block << ", statements);\n"
+        << "}\n";
+
+    return out.str();
+}
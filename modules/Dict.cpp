@@ -0,0 +1,134 @@
+#include "../includes/Dict.hpp"
+#include <functional>
+
+
+static const std::vector<gvl::Dict::Entry> no_entries;
+
+// the index is kept at most half full, probe sequences stay short
+static constexpr std::size_t min_slots = 8;
+
+
+std::size_t gvl::Dict::probe(const Table& t, TokenSv key, std::size_t hash)
+{
+    const std::size_t mask = t.slots.size() - 1;
+
+    for (std::size_t idx = hash & mask;; idx = (idx + 1) & mask)
+    {
+        const std::uint32_t slot = t.slots[idx];
+
+        if (slot == empty_slot)
+            return idx;
+
+        const Entry& entry = t.entries[slot - 1];
+        if (entry.hash == hash && entry.key == key)
+            return idx;
+    }
+}
+
+const gvl::Token* gvl::Dict::find(TokenSv key) const
+{
+    if (!this->table || this->table->entries.empty())
+        return nullptr;
+
+    const std::size_t slot = this->table->slots[probe(*this->table, key, std::hash<TokenSv>()(key))];
+
+    return slot == empty_slot ? nullptr : &this->table->entries[slot - 1].value;
+}
+
+void gvl::Dict::insert_or_assign(TokenSv key, const Token& value)
+{
+    detach();
+
+    const std::size_t hash = std::hash<TokenSv>()(key);
+    std::size_t idx = probe(*this->table, key, hash);
+
+    if (this->table->slots[idx] != empty_slot)
+    {
+        this->table->entries[this->table->slots[idx] - 1].value = value;
+        return;
+    }
+
+    if (2 * (this->table->entries.size() + 1) > this->table->slots.size())
+    {
+        grow();
+        idx = probe(*this->table, key, hash);
+    }
+
+    this->table->entries.push_back(Entry{ Token(key), value, hash });
+    this->table->slots[idx] = static_cast<std::uint32_t>(this->table->entries.size());
+}
+
+bool gvl::Dict::erase(TokenSv key)
+{
+    if (!contains(key))
+        return false;
+
+    detach();
+
+    Table& t = *this->table;
+    const std::size_t mask = t.slots.size() - 1;
+    std::size_t hole = probe(t, key, std::hash<TokenSv>()(key));
+    const std::uint32_t removed = t.slots[hole];
+
+    // backward shift: pull later members of the probe run into the hole, no tombstones are left
+    for (std::size_t idx = (hole + 1) & mask; t.slots[idx] != empty_slot; idx = (idx + 1) & mask)
+    {
+        const std::size_t home = t.entries[t.slots[idx] - 1].hash & mask;
+
+        if (((idx - home) & mask) >= ((idx - hole) & mask))
+        {
+            t.slots[hole] = t.slots[idx];
+            hole = idx;
+        }
+    }
+    t.slots[hole] = empty_slot;
+
+    // the last entry fills the removed one's place in the dense array
+    const std::uint32_t last = static_cast<std::uint32_t>(t.entries.size());
+    if (removed != last)
+    {
+        t.slots[probe(t, t.entries[last - 1].key, t.entries[last - 1].hash)] = removed;
+        t.entries[removed - 1] = std::move(t.entries[last - 1]);
+    }
+    t.entries.pop_back();
+
+    return true;
+}
+
+gvl::Dict::const_iterator gvl::Dict::begin() const
+{
+    return this->table ? this->table->entries.cbegin() : no_entries.cbegin();
+}
+
+gvl::Dict::const_iterator gvl::Dict::end() const
+{
+    return this->table ? this->table->entries.cend() : no_entries.cend();
+}
+
+void gvl::Dict::detach()
+{
+    if (!this->table)
+    {
+        this->table = std::make_shared<Table>();
+        this->table->slots.assign(min_slots, empty_slot);
+    }
+    else if (this->table.use_count() > 1)
+        this->table = std::make_shared<Table>(*this->table);
+}
+
+void gvl::Dict::grow()
+{
+    Table& t = *this->table;
+    t.slots.assign(2 * t.slots.size(), empty_slot);
+
+    const std::size_t mask = t.slots.size() - 1;
+
+    for (std::size_t i = 0; i < t.entries.size(); ++i)
+    {
+        std::size_t idx = t.entries[i].hash & mask;
+        while (t.slots[idx] != empty_slot)
+            idx = (idx + 1) & mask;
+
+        t.slots[idx] = static_cast<std::uint32_t>(i + 1);
+    }
+}
@@ -1,4 +1,12 @@
 #include "../includes/Interpreter.hpp"
+#include "../includes/ThreadPool.hpp"
+#include "../includes/Channel.hpp"
+#include "../includes/ArrayIO.hpp"
+#include "../includes/ArrayOps.hpp"
+#include "../includes/StrOps.hpp"
+#include "../includes/Tracer.hpp"
+#include "../includes/Snapshot.hpp"
+#include "../includes/Budget.hpp"
 #include <string>
 #include <string_view>
 #include <vector>
@@ -7,9 +15,15 @@
 #include <cctype>
 #include <map>
 #include <set>
-#include <cassert>
 #include <ranges>
 #include <algorithm>
+#include <mutex>
+#include <utility>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <stdexcept>
+#include <charconv>
 
 
 std::ostream& operator<<(std::ostream& out, const gvl::VarLikeType type)
@@ -23,6 +37,7 @@ std::ostream& operator<<(std::ostream& out, const gvl::VarLikeType type)
                 INSERT_ELEMENT(gvl::VarLikeType::INT);
                 INSERT_ELEMENT(gvl::VarLikeType::STRING);
                 INSERT_ELEMENT(gvl::VarLikeType::ARRAY);             
+                INSERT_ELEMENT(gvl::VarLikeType::DICT);
                 INSERT_ELEMENT(gvl::VarLikeType::NONE);                
         #undef INSERT_ELEMENT
     }   
@@ -31,11 +46,11 @@ std::ostream& operator<<(std::ostream& out, const gvl::VarLikeType type)
 }
 
 
-gvl::Interpreter::VarLikeMap gvl::Interpreter::variables;
+thread_local gvl::Interpreter::VarLikeMap gvl::Interpreter::variables;
 
-std::array<gvl::Token, gvl::args_max_num> gvl::Interpreter::args;
+thread_local std::array<gvl::Token, gvl::args_max_num> gvl::Interpreter::args;
 
-std::size_t gvl::Interpreter::block_lvl = 0;
+thread_local std::size_t gvl::Interpreter::block_lvl = 0;
 
 std::unordered_map<gvl::TokenSv, char> gvl::Interpreter::format_keywords = { 
     std::pair<gvl::TokenSv, char>("nl", '\n'),
@@ -43,7 +58,119 @@ std::unordered_map<gvl::TokenSv, char> gvl::Interpreter::format_keywords = {
     std::pair<gvl::TokenSv, char>("space", ' ')
 };
 
-std::unordered_set<std::pair<gvl::TokenSv, gvl::Statement*>, gvl::HashTokenStmtPair> gvl::Interpreter::ud_funcs;
+namespace
+{
+    struct SpawnedTask
+    {
+        gvl::Statement function;     // private copy, bound to the arguments of the spawn
+        std::vector<gvl::Token> outputs;
+        std::vector<std::pair<gvl::Token, gvl::VarLike>> results;
+        std::atomic<bool> done=false;
+        std::exception_ptr error;
+    };
+}
+
+struct gvl::Interpreter::Context : std::enable_shared_from_this<Context>
+{
+    std::ostream* output = &std::cout;
+    std::istream* input = &std::cin;
+
+    // pfor iterations and spawned tasks may print and read concurrently
+    std::mutex io_mutex;
+
+    // functions are defined by the main program while spawned tasks look them up
+    std::mutex functions_mutex;
+    std::unordered_map<TokenSv, Statement*> ud_funcs;
+    std::unordered_map<const Statement*, std::shared_ptr<const BoundFunction>> bound_funcs;
+
+    // guarded by functions_mutex, the caches themselves lock on their own
+    std::map<Token, std::unique_ptr<MemoCache>, std::less<>> memo_caches;
+
+    std::mutex tasks_mutex;
+    std::unordered_map<Token, std::shared_ptr<SpawnedTask>> tasks;
+    std::size_t tasks_no = 0;
+    std::vector<Token> channels;        // handles of the channels created, guarded by tasks_mutex
+
+    // lives as long as the tasks of the run do, which keep the context alive
+    std::unique_ptr<Budget> budget;
+};
+
+// threads that were not given a context of their own, the command line runs in it
+static const std::shared_ptr<gvl::Interpreter::Context> default_context = std::make_shared<gvl::Interpreter::Context>();
+
+thread_local gvl::Interpreter::Context* gvl::Interpreter::context = default_context.get();
+
+// numbers the activations of functions, their variables are suffixed with it
+static thread_local std::size_t activations_no = 0;
+
+// starts the tokens a bound function body has in place of its parameters and locals, the slot's number follows
+static constexpr char slot_mark = '\x01';
+
+namespace
+{
+    // a missed call of a pure function, its results are stored once the activation returns
+    struct PendingMemo
+    {
+        gvl::MemoCache* cache;
+        gvl::Token key;
+        std::array<gvl::Token, 3> arguments;
+        std::array<bool, 3> is_variable;
+    };
+}
+
+struct gvl::Interpreter::Frame
+{
+    Interpreter* scope=nullptr;
+    std::unique_ptr<Interpreter> owned_scope;   // null for the frame a run starts from
+    std::size_t pc=0;
+    const Statement* loop=nullptr;              // while statement this frame is the body of
+    Interpreter* loop_scope=nullptr;
+    std::unique_ptr<Jit::HotLoop> hot_loop;
+    const Statement* for_each=nullptr;          // for statement this frame is the body of, over lines or over a generator
+    std::unique_ptr<LineReader> lines;
+    std::unique_ptr<Generator> generator;
+    std::shared_ptr<const BoundFunction> function;   // for the body of a call
+    std::vector<Token> slots;                   // the names of its slots, the variables view them
+    Token suffix;
+    std::vector<PendingMemo> memos;             // including those of the calls this one replaced by tail calls
+    const char* trace_category=nullptr;         // the frame's span, recorded when it is popped
+    TokenSv trace_name;
+    std::size_t trace_line=0;
+    std::uint64_t trace_begin=0;
+    std::size_t iterations=1;
+
+    void trace(const char* category, TokenSv name, std::size_t line_no)
+    {
+        if (!Tracer::is_enabled())
+            return;
+
+        trace_category = category;
+        trace_name = name;
+        trace_line = line_no;
+        trace_begin = Tracer::now();
+    }
+
+    // sets the for loop's variable to its next line or value, false at the end
+    bool next_element()
+    {
+        if (lines)
+        {
+            std::string_view line;
+            if (!lines->next(line))
+                return false;
+
+            Interpreter::set_line(*loop_scope, for_each->expression.left, line);
+            return true;
+        }
+
+        Token value;
+        if (!generator->next(value))
+            return false;
+
+        Interpreter::set_line(*loop_scope, for_each->expression.left, value);
+        return true;
+    }
+};
 
 
 static bool is_number(const gvl::TokenSv& tokenSv)
@@ -86,80 +213,311 @@ static gvl::VarLikeType get_varlike_type(gvl::TokenSv sv)
     return gvl::VarLikeType::NONE;
 }
 
-static void print_array_elements(const auto& array_elements, const gvl::Interpreter::VarLikeMap& vmap)
+static void print_dict_entries(std::ostream& out, const gvl::Dict& dict)
+{
+    for (const gvl::Dict::Entry& entry : dict)
+        out << entry.key << ": " << entry.value << " ";
+}
+
+static void print_array_elements(std::ostream& out, const auto& array_elements, const gvl::Interpreter::VarLikeMap& vmap)
 {
     for (const auto& element : array_elements)
     {
-        if (vmap.contains(element))
+        const auto it = vmap.find(element);
+
+        if (it != vmap.end() && it->second.type == gvl::VarLikeType::DICT)
+        {
+            out << " { ";
+            print_dict_entries(out, it->second.dict_entries);
+            out << "} ";
+        }
+        else if (it != vmap.end())
         {
-            std::cout << " [ ";
-            print_array_elements( vmap.at(element).array_elements, vmap);
-            std::cout << "] ";
+            out << " [ ";
+            print_array_elements(out, it->second.array_elements, vmap);
+            out << "] ";
         }
         else
-            std::cout << element << " ";
+            out << element << " ";
+    }
+}
+
+gvl::VarLikeType gvl::Interpreter::deduce_type(TokenSv value)
+{
+    return get_varlike_type(value);
+}
+
+void gvl::Interpreter::reset_state()
+{
+    variables.clear();
+    block_lvl = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(context->functions_mutex);
+        context->ud_funcs.clear();
+        context->bound_funcs.clear();
+        context->memo_caches.clear();
     }
+
+    std::lock_guard<std::mutex> lock(context->tasks_mutex);
+    context->tasks.clear();
+
+    for (const Token& handle : context->channels)
+        Channel::forget(handle);
+    context->channels.clear();
+}
+
+std::shared_ptr<gvl::Interpreter::Context> gvl::Interpreter::make_context()
+{
+    return std::make_shared<Context>();
+}
+
+void gvl::Interpreter::set_context(Context* ctx)
+{
+    context = ctx;
+    Budget::install(ctx->budget.get());
+}
+
+void gvl::Interpreter::start_budget(const Budget::Limits& limits)
+{
+    std::unique_ptr<Budget> budget = std::make_unique<Budget>(limits);
+    Budget::install(budget.get());
+    context->budget = std::move(budget);
+}
+
+std::ostream& gvl::Interpreter::get_output_stream()
+{
+    return *context->output;
+}
+
+void gvl::Interpreter::set_output_stream(std::ostream& out)
+{
+    context->output = &out;
+}
+
+std::istream& gvl::Interpreter::get_input_stream()
+{
+    return *context->input;
+}
+
+void gvl::Interpreter::set_input_stream(std::istream& in)
+{
+    context->input = &in;
+}
+
+const std::unordered_map<gvl::TokenSv, gvl::Statement*>& gvl::Interpreter::get_ud_funcs() const
+{
+    return context->ud_funcs;
 }
 
 void gvl::Interpreter::print_vars() const
 {
     using namespace std::string_view_literals;
 
-    for (const auto& [ name, varlike ] : this->variables)
+    std::ostream& out = get_output_stream();
+
+    // by name, the order of the map depends on how it was filled
+    std::vector<const VarLikeMap::value_type*> sorted;
+    sorted.reserve(this->variables.size());
+
+    for (const auto& entry : this->variables)
+        sorted.push_back(&entry);
+
+    std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    for (const auto* entry : sorted)
     {
-        std::cout << "Name: "sv << name << "\tValue: "sv << varlike.value
+        const auto& [ name, varlike ] = *entry;
+
+        out << "Name: "sv << name << "\tValue: "sv << varlike.value
         << "\tType: "sv << varlike.type;
         
         if (!varlike.array_elements.empty())
         {
-            std::cout << "\tArray Elements: [ "sv;
-            print_array_elements(varlike.array_elements, this->variables);
-            std::cout << "]"sv;
+            out << "\tArray Elements: [ "sv;
+            print_array_elements(out, varlike.array_elements, this->variables);
+            out << "]"sv;
         }
-        std::cout << "\n"sv;
+
+        if (!varlike.dict_entries.empty())
+        {
+            out << "\tDict Entries: { "sv;
+            print_dict_entries(out, varlike.dict_entries);
+            out << "}"sv;
+        }
+        out << "\n"sv;
     }
     
 }
 
-static gvl::Token get_varlike_value(const gvl::Interpreter interpreter, gvl::TokenSv sv)
+static gvl::Token get_varlike_value(const gvl::Interpreter& interpreter, gvl::TokenSv sv)
 {
-    gvl::Token result;
+    sv = interpreter.bound(sv);
+    const auto it = interpreter.get_var_map().find(sv);
+
+    return it != interpreter.get_var_map().end() ? it->second.value : gvl::Token(sv);
+}
+
+// the variable called name, for const and mutable maps alike
+template <typename Map>
+static auto& variable_at(Map& vmap, gvl::TokenSv name)
+{
+    const auto it = vmap.find(name);
 
-    try { result = interpreter.get_var_map().at(sv).value; } catch (std::out_of_range&) { result = sv; }
+    if (it == vmap.end())
+        throw gvl::Interpreter::RunTimeError(gvl::Interpreter::ErrorCode::UNDEFINED_VARIABLE, "undefined variable '" + gvl::Token(name) + "'");
 
-    return result;
+    return it->second;
+}
+
+// an array index or size written in a script, negative values and other text are errors
+static std::size_t to_index(gvl::TokenSv value)
+{
+    std::size_t index = 0;
+    const auto [ end, ec ] = std::from_chars(value.data(), value.data() + value.size(), index);
+
+    // the calculator prints whole doubles as 3.000000
+    if (ec != std::errc() || (end != value.data() + value.size() &&
+        (*end != '.' || std::any_of(end + 1, value.data() + value.size(), [](char c) { return c != '0'; }))))
+        throw gvl::Interpreter::RunTimeError(gvl::Interpreter::ErrorCode::INVALID_NUMBER, "'" + gvl::Token(value) + "' is not an array index");
+
+    return index;
 }
 
 struct ExpressionEvaluation
 {
     gvl::Token result;
     gvl::VarLikeType type=gvl::VarLikeType::NONE;
-    std::vector<gvl::Token> array_values;
+    gvl::ArrayStorage array_values;
+    gvl::Dict dict_entries;
 };
 
+// quotes only delimit string literals, they are dropped here and never stored in a value
 static std::pair<gvl::Token, gvl::VarLikeType> get_value_and_type(gvl::TokenSv tokenSv, const gvl::Interpreter& interpreter)
 {
     std::pair<gvl::Token, gvl::VarLikeType> pair;
+    tokenSv = interpreter.bound(tokenSv);
+    const auto& it = interpreter.get_var_map().find(tokenSv);
 
-    try 
+    if (it != interpreter.get_var_map().end())
     {
-        gvl::VarLike vl = interpreter.get_var_map().at(tokenSv);
-        pair.first = vl.value;
-    } 
-    catch (const std::out_of_range&) 
-    { 
-        
-        if (interpreter.get_format_keywords().contains(tokenSv))
-            pair.first = interpreter.get_format_keywords().at(tokenSv);
-        else
-            pair.first = tokenSv;
+        pair.first = it->second.value;
+        pair.second = get_varlike_type(pair.first);
+        return pair;
     }
 
+    const auto keyword = interpreter.get_format_keywords().find(tokenSv);
+
+    if (keyword != interpreter.get_format_keywords().end())
+        pair.first = keyword->second;
+    else
+        pair.first = tokenSv;
+
     pair.second = get_varlike_type(pair.first);
 
+    if (pair.second == gvl::VarLikeType::STRING)
+        pair.first.erase(std::remove(pair.first.begin(), pair.first.end(), '\''), pair.first.end());
+
     return pair;
 }
 
+// an int written the way the calculator prints it, which a copy can keep as it is
+static bool is_printed_int(gvl::TokenSv value)
+{
+    int number;
+    const auto [ end, ec ] = std::from_chars(value.data(), value.data() + value.size(), number);
+
+    if (ec != std::errc() || end != value.data() + value.size())
+        return false;
+
+    const std::size_t digits = value.front() == '-' ? 1 : 0;
+    return value.size() - digits == 1 ? value != "-0" : value[digits] != '0';
+}
+
+// appends what 'name = name <middle> <right>' adds to a string, see the string case of evaluate_expression
+static void append_to_string(const gvl::Interpreter& interpreter, gvl::Token& value, const gvl::Statement& stmt)
+{
+    const auto keyword = interpreter.get_format_keywords().find(interpreter.bound(stmt.expression.middle));
+
+    if (keyword != interpreter.get_format_keywords().end())
+        value += keyword->second;
+
+    if (!stmt.expression.right.empty())
+        value += get_value_and_type(stmt.expression.right, interpreter).first;
+}
+
+// an element naming an array or a dict stands for it, the result shares its elements
+static bool share_container(const gvl::Interpreter& interpreter, gvl::TokenSv name, ExpressionEvaluation& expreval)
+{
+    const auto& it = interpreter.get_var_map().find(interpreter.bound(name));
+
+    if (it == interpreter.get_var_map().end())
+        return false;
+
+    if (it->second.type == gvl::VarLikeType::DICT)
+    {
+        expreval.type = gvl::VarLikeType::DICT;
+        expreval.dict_entries = it->second.dict_entries;
+        return true;
+    }
+
+    if (it->second.type == gvl::VarLikeType::ARRAY || !it->second.array_elements.empty())
+    {
+        expreval.type = gvl::VarLikeType::ARRAY;
+        expreval.array_values = it->second.array_elements;
+        return true;
+    }
+
+    return false;
+}
+
+// numbers are keyed by value, so 2 and 2.000000 or 0.5 and 0.50 find the same entry
+static gvl::Token dict_key(const gvl::Interpreter& interpreter, gvl::TokenSv token)
+{
+    auto [ key, type ] = get_value_and_type(token, interpreter);
+
+    if (type == gvl::VarLikeType::INT)
+    {
+        key.erase(std::min(key.find('.'), key.size()));
+        key.erase(0, std::min(key.find_first_not_of('0'), key.size() - 1));
+    }
+    else if (type == gvl::VarLikeType::DOUBLE)
+    {
+        double value = 0;
+        char buffer[64];
+
+        std::from_chars(key.data(), key.data() + key.size(), value);
+        key.assign(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+    }
+
+    return key;
+}
+
+// the text an operand of a string builtin stands for, a variable's value is read in place
+static const gvl::Token& string_operand(const gvl::Interpreter& interpreter, gvl::TokenSv token, gvl::Token& literal)
+{
+    const auto it = interpreter.get_var_map().find(interpreter.bound(token));
+
+    if (it != interpreter.get_var_map().end())
+        return it->second.value;
+
+    literal = get_value_and_type(token, interpreter).first;
+    return literal;
+}
+
+static const gvl::Token& dict_get(const gvl::Interpreter& interpreter, const gvl::Statement& stmt)
+{
+    const gvl::Token key = dict_key(interpreter, stmt.expression.right);
+    const gvl::Token& name = interpreter.bound(stmt.expression.middle);
+    const gvl::Token* value = variable_at(interpreter.get_var_map(), name).dict_entries.find(key);
+
+    if (value == nullptr)
+        throw gvl::Interpreter::RunTimeError(gvl::Interpreter::ErrorCode::MISSING_KEY,
+            "key '" + key + "' is not in dict '" + name + "'");
+
+    return *value;
+}
+
 static ExpressionEvaluation evaluate_expression(const gvl::Interpreter& interpreter, const gvl::Statement& stmt)
 {
     using namespace std::string_view_literals;
@@ -173,58 +531,100 @@ static ExpressionEvaluation evaluate_expression(const gvl::Interpreter& interpre
     {
         index = get_varlike_value(interpreter, stmt.expression.right);
         
-        result = interpreter.get_var_map().at
-        (stmt.expression.middle).array_elements.at(std::stoi(index));
-
-        try 
-        {
-            const auto& array_elements = interpreter.get_var_map().at(result).array_elements;
-            if (!array_elements.empty())
-            {
-                expreval.type = gvl::VarLikeType::ARRAY;
-                for (const auto& element : array_elements)
-                    expreval.array_values.push_back(element);
-            }
+        result = variable_at(interpreter.get_var_map(), interpreter.bound(stmt.expression.middle)).array_elements.at(to_index(index));
 
-        } 
-        catch (std::out_of_range&) { expreval.type = get_varlike_type(result); }
+        if (!share_container(interpreter, result, expreval) && !interpreter.get_var_map().contains(result))
+            expreval.type = get_varlike_type(result);
         
         expreval.result = result;
         return expreval;
     }
+    else if (stmt.expression.left.compare("$dict_get"sv) == 0)
+    {
+        expreval.result = dict_get(interpreter, stmt);
+
+        if (!share_container(interpreter, expreval.result, expreval))
+            expreval.type = get_varlike_type(expreval.result);
+
+        return expreval;
+    }
+    else if (stmt.expression.left.compare("$dict_has"sv) == 0)
+    {
+        // numeric, so that it can be tested by a condition
+        const Dict& dict = variable_at(interpreter.get_var_map(), interpreter.bound(stmt.expression.middle)).dict_entries;
+        expreval.result = dict.contains(dict_key(interpreter, stmt.expression.right)) ? "1" : "0";
+        expreval.type = VarLikeType::INT;
+        return expreval;
+    }
+    else if (stmt.expression.left.compare("$dict_len"sv) == 0)
+    {
+        const Dict& dict = variable_at(interpreter.get_var_map(), interpreter.bound(stmt.expression.middle)).dict_entries;
+        expreval.result = std::to_string(dict.size());
+        expreval.type = VarLikeType::INT;
+        return expreval;
+    }
     else if (stmt.expression.left.compare("$array_len"sv) == 0)
     {
-        expreval.result = std::to_string(interpreter.get_var_map().at(stmt.expression.middle).array_elements.size());
+        const ArrayStorage& elements = variable_at(interpreter.get_var_map(), interpreter.bound(stmt.expression.middle)).array_elements;
+        expreval.result = std::to_string(elements.size());
         expreval.type = VarLikeType::INT;
         return expreval;
     }
-    else if (stmt.expression.left.compare("$array_pop"sv) == 0)
+    else if (stmt.expression.left.compare("$array_bsearch"sv) == 0)
     {
-        const gvl::VarLike& varlike = interpreter.get_var_map().at(stmt.expression.middle);
-        
-        assert(!varlike.array_elements.empty());
+        const ArrayStorage& elements = variable_at(interpreter.get_var_map(), interpreter.bound(stmt.expression.middle)).array_elements;
+        expreval.result = std::to_string(ArrayOps::bsearch(elements, get_varlike_value(interpreter, stmt.expression.right)));
+        expreval.type = VarLikeType::INT;
+        return expreval;
+    }
+    else if (stmt.expression.left.compare("$str_len"sv) == 0)
+    {
+        expreval.result = std::to_string(string_operand(interpreter, stmt.expression.middle, tmp).size());
+        expreval.type = VarLikeType::INT;
+        return expreval;
+    }
+    else if (stmt.expression.left.compare("$str_find"sv) == 0 || stmt.expression.left.compare("$str_count"sv) == 0)
+    {
+        const Token& text = string_operand(interpreter, stmt.expression.middle, l);
+        const Token& needle = string_operand(interpreter, stmt.expression.right, r);
 
-        const auto& back = varlike.array_elements.back();
+        expreval.result = std::to_string(stmt.expression.left.compare("$str_find"sv) == 0 ?
+            StrOps::find(text, needle) : StrOps::count(text, needle));
+        expreval.type = VarLikeType::INT;
+        return expreval;
+    }
+    else if (stmt.expression.left.compare("$str_replace"sv) == 0)
+    {
+        // the replacement is read from the line, as the expression only has room for three tokens
+        expreval.result = StrOps::replace(string_operand(interpreter, stmt.expression.middle, l),
+            string_operand(interpreter, stmt.expression.right, r), string_operand(interpreter, stmt.line.back(), tmp));
+        expreval.type = get_varlike_type(expreval.result);
+        return expreval;
+    }
+    else if (stmt.expression.left.compare("$array_pop"sv) == 0)
+    {
+        const gvl::VarLike& varlike = variable_at(interpreter.get_var_map(), interpreter.bound(stmt.expression.middle));
 
-        expreval.result = back;
-        expreval.type = get_varlike_type(back);
+        if (varlike.array_elements.empty())
+            throw Interpreter::RunTimeError(Interpreter::ErrorCode::EMPTY_ARRAY,
+                "pop from empty array '" + interpreter.bound(stmt.expression.middle) + "'");
 
-        try 
-        {
-            const std::vector<Token>& elements = interpreter.get_var_map().at(back).array_elements;
-            expreval.type = VarLikeType::ARRAY;
+        // a popped array or dict is shared like $array_at shares it, not moved over element by element
+        expreval.result = varlike.array_elements.back();
 
-            while (!elements.empty())
-            {
-                expreval.array_values.push_back(elements.back());
-                const_cast<std::vector<Token>&> (elements).pop_back();
+        if (!share_container(interpreter, expreval.result, expreval))
+            expreval.type = get_varlike_type(expreval.result);
 
-            }
-        } 
-        catch (std::out_of_range&) { const_cast<std::vector<Token>&> (varlike.array_elements).pop_back(); }
+        const_cast<ArrayStorage&> (varlike.array_elements).pop_back();
 
         return expreval;
     }
+    else if (stmt.expression.middle.empty() && share_container(interpreter, stmt.expression.left, expreval))
+    {
+        // copying an array or a dict shares its elements until either side is written to
+        expreval.result = interpreter.bound(stmt.expression.left);
+        return expreval;
+    }
 
     VarLike vl_left, vl_right;
     VarLikeType l_type = VarLikeType::NONE, r_type = VarLikeType::NONE;
@@ -233,6 +633,13 @@ static ExpressionEvaluation evaluate_expression(const gvl::Interpreter& interpre
     l_type = pair.second;
     l = pair.first;
 
+    if (stmt.expression.middle.empty() && l_type == VarLikeType::INT && is_printed_int(l))
+    {
+        expreval.result = std::move(l);
+        expreval.type = VarLikeType::INT;
+        return expreval;
+    }
+
     if (!stmt.expression.right.empty())
     {
         pair = get_value_and_type(stmt.expression.right, interpreter);
@@ -240,16 +647,13 @@ static ExpressionEvaluation evaluate_expression(const gvl::Interpreter& interpre
         r = pair.first;
     }
 
-    assert(l_type != VarLikeType::NONE);
+    if (l_type == VarLikeType::NONE)
+        throw Interpreter::RunTimeError(Interpreter::ErrorCode::INVALID_EXPRESSION, "expression without a value");
 
     tmp = l;
     
     if (l_type == VarLikeType::STRING)
-    {
-        if (interpreter.get_format_keywords().contains(stmt.expression.middle))
-            tmp += interpreter.get_format_keywords().at(stmt.expression.middle);
-        tmp += r;
-    }
+        append_to_string(interpreter, tmp, stmt);
     else if (l_type == VarLikeType::BOOL)
     {
         tmp += ' ';
@@ -257,7 +661,7 @@ static ExpressionEvaluation evaluate_expression(const gvl::Interpreter& interpre
         if (!stmt.expression.right.empty())
         {
             tmp += ' ';
-            tmp += stmt.expression.right;
+            tmp += interpreter.bound(stmt.expression.right);
         }
     }
     else
@@ -271,15 +675,13 @@ static ExpressionEvaluation evaluate_expression(const gvl::Interpreter& interpre
 
     if (l_type == VarLikeType::STRING)
     {
-        tmp.erase(std::remove(tmp.begin(), tmp.end(), '\''), tmp.end());
-        expreval.result = tmp;
+        expreval.result = std::move(tmp);
         expreval.type = VarLikeType::STRING;
         return expreval;
     }
     else
     {
-        Calculator calculator = interpreter.get_calculator();
-        calculator.set_expression(tmp);
+        const Calculator calculator(tmp);
 
         if (l_type == VarLikeType::INT)
         {
@@ -313,13 +715,15 @@ static ExpressionEvaluation evaluate_expression(const gvl::Interpreter& interpre
 gvl::Interpreter::Info gvl::Interpreter::execute_init(Interpreter& interpreter, const Statement& stmt)
 { 
     VarLike varlike;
-    varlike.name = stmt.line[1];
+    varlike.name = interpreter.bound(stmt.line[1]);
 
     if (!interpreter.variables.contains(varlike.name))
     {
         const ExpressionEvaluation& expreval = evaluate_expression(interpreter, stmt);
-        varlike.value = expreval.result;
+        const bool container = expreval.type == VarLikeType::ARRAY || expreval.type == VarLikeType::DICT;
+        varlike.value = container ? Token(varlike.name) : expreval.result;
         varlike.array_elements = expreval.array_values;
+        varlike.dict_entries = expreval.dict_entries;
         varlike.type = expreval.type;
         varlike.is_const = stmt.type == StatementType::CONST;
         
@@ -334,11 +738,33 @@ gvl::Interpreter::Info gvl::Interpreter::execute_init(Interpreter& interpreter,
 
 gvl::Interpreter::Info gvl::Interpreter::execute_assign(Interpreter& interpreter, const Statement& stmt)
 { 
-    const Token& name = stmt.line.front();
-    VarLike& varlike = interpreter.variables.at(name);
+    const Token& name = interpreter.bound(stmt.line.front());
+    VarLike& varlike = variable_at(interpreter.variables, name);
 
-    if (!varlike.is_const)
-        varlike.value = evaluate_expression(interpreter, stmt).result;
+    if (varlike.is_const)
+        return gvl::Interpreter::Info();
+
+    // s = s + x grows s in place, so building a string piece by piece stays linear
+    if (interpreter.bound(stmt.expression.left) == name && get_varlike_type(varlike.value) == VarLikeType::STRING)
+    {
+        const std::size_t size = varlike.value.size();
+        append_to_string(interpreter, varlike.value, stmt);
+        Budget::allocate(varlike.value.size() - size);
+    }
+    else
+    {
+        ExpressionEvaluation expreval = evaluate_expression(interpreter, stmt);
+
+        if (expreval.type == VarLikeType::ARRAY || expreval.type == VarLikeType::DICT)
+        {
+            varlike.value = name;
+            varlike.type = expreval.type;
+            varlike.array_elements = std::move(expreval.array_values);
+            varlike.dict_entries = std::move(expreval.dict_entries);
+        }
+        else
+            varlike.value = std::move(expreval.result);
+    }
 
 
     return gvl::Interpreter::Info(); 
@@ -348,22 +774,31 @@ static void print_token(const gvl::Interpreter& interpreter, gvl::TokenSv token)
 {
     using namespace std::string_view_literals;
 
-    if (interpreter.get_var_map().contains(token))
-        std::cout << interpreter.get_var_map().at(token).value;
-    else if (interpreter.get_format_keywords().contains(token))
-        std::cout << interpreter.get_format_keywords().at(token);
+    std::ostream& out = interpreter.get_output_stream();
+
+    token = interpreter.bound(token);
+    const auto it = interpreter.get_var_map().find(token);
+    const auto keyword = it == interpreter.get_var_map().end() ? interpreter.get_format_keywords().find(token) :
+        interpreter.get_format_keywords().end();
+
+    if (it != interpreter.get_var_map().end())
+        out << it->second.value;
+    else if (keyword != interpreter.get_format_keywords().end())
+        out << keyword->second;
     else if (!token.empty())
     {
         if (token.find('\'') != std::string_view::npos)
-            std::copy(token.begin() + 1, token.end() - 1, std::ostream_iterator<char>(std::cout, ""));
+            std::copy(token.begin() + 1, token.end() - 1, std::ostream_iterator<char>(out, ""));
         else
-            std::cout << token;
+            out << token;
     }
 }
 
 gvl::Interpreter::Info gvl::Interpreter::execute_print_related(Interpreter& interpreter, const Statement& stmt)
 { 
     const Expression& tokens = stmt.expression;
+    Tracer::Span span("io", stmt.line.front(), stmt.line_no);
+    std::lock_guard<std::mutex> lock(context->io_mutex);
     
     print_token(interpreter, tokens.left);
     print_token(interpreter, tokens.middle);
@@ -372,7 +807,7 @@ gvl::Interpreter::Info gvl::Interpreter::execute_print_related(Interpreter& inte
     using namespace std::string_view_literals;
     
     if (stmt.type == StatementType::PRINTLN)
-        std::cout << "\n"sv;
+        interpreter.get_output_stream() << "\n"sv;
 
     return gvl::Interpreter::Info(); 
 }
@@ -383,15 +818,19 @@ static void read_token(gvl::Interpreter& interpreter, gvl::TokenSv token)
 {
     if (!token.empty())
     {
+        std::istream& in = interpreter.get_input_stream();
         T value = T();
-        std::cin >> value;
-        const_cast<gvl::VarLike&> (interpreter.get_var_map().at(token)).value = std::to_string(value);
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max());
+        in >> value;
+        const_cast<gvl::VarLike&> (variable_at(interpreter.get_var_map(), interpreter.bound(token))).value = std::to_string(value);
+        in.ignore(std::numeric_limits<std::streamsize>::max());
     }
 }
 
 gvl::Interpreter::Info gvl::Interpreter::execute_read_related(Interpreter& interpreter, const Statement& stmt)
 {
+    Tracer::Span span("io", stmt.line.front(), stmt.line_no);
+    std::lock_guard<std::mutex> lock(context->io_mutex);
+
     if (stmt.type == gvl::StatementType::READINT)
     {
         read_token<int>(interpreter, stmt.expression.left);
@@ -408,198 +847,1330 @@ gvl::Interpreter::Info gvl::Interpreter::execute_read_related(Interpreter& inter
     return gvl::Interpreter::Info(); 
 }
 
-gvl::Interpreter::Info gvl::Interpreter::execute_block(Interpreter& interpreter, const Statement& stmt)
+bool gvl::Interpreter::evaluate_condition(const Interpreter& interpreter, const Statement& stmt)
 {
-    bool is_true = stmt.type == StatementType::DEF_FUNC ? true : false;
+    if (stmt.type == StatementType::DEF_FUNC)
+        return true;
 
-    if (stmt.type != StatementType::DEF_FUNC)
-    {
-        Token left_operand, right_operand, oper;
-        TokenSv result;
+    const Token left_operand = get_varlike_value(interpreter, stmt.expression.left);
+    const Token right_operand = get_varlike_value(interpreter, stmt.expression.right);
+        
+    Calculator calculator;
+    return calculator.evaluate_basic_expression<double>(left_operand, right_operand, stmt.expression.middle);
+}
 
-        result = get_varlike_value(interpreter, stmt.expression.left);
+void gvl::Interpreter::push_block(CallStack& frames, const Program::StmtContainer& body)
+{
+    ++Interpreter::block_lvl;
 
-        if (!result.empty())
-            left_operand = result;
-        else
-            left_operand = stmt.expression.left;
-        
-        result = get_varlike_value(interpreter, stmt.expression.right);
+    const std::vector<Token>* slots = frames.empty() ? nullptr : frames.back().scope->slots;
 
-        if (!result.empty())
-            right_operand = result;
-        else
-            right_operand = stmt.expression.right;
-        
-        oper = stmt.expression.middle;
-            
-        Calculator calculator;
-        is_true = calculator.evaluate_basic_expression<double>(left_operand, right_operand, oper);
+    Frame& frame = frames.emplace_back();
+    frame.owned_scope.reset(new Interpreter(body));
+    frame.scope = frame.owned_scope.get();
+    frame.scope->slots = slots;
+}
+
+void gvl::Interpreter::finish_frame(CallStack& frames, bool looping)
+{
+    Frame& frame = frames.back();
+
+    if (!frame.owned_scope)
+    {
+        frames.pop_back();
+        return;
     }
 
-    if (is_true)
+    --Interpreter::block_lvl;
+
+    std::vector<Token> results;
+    for (const PendingMemo& memo : frame.memos)
     {
-        ++Interpreter::block_lvl;
-        Program program;
-        program.statements = stmt.main_body;
-        program.args = interpreter.args;
-        Interpreter sub(program);
-        sub.execute_program();
-        --Interpreter::block_lvl;
-        
-        clear_scope(sub, sub.tmp_var_names);
+        if (memo_results(memo.arguments, memo.is_variable, results))
+            memo.cache->store(memo.key, results);
+    }
+
+    clear_scope(*frame.scope, frame.scope->tmp_var_names);
+
+    if (looping && frame.loop != nullptr)
+    {
+        // the back-edge counts as the condition's statement, so even empty bodies use up the budget
+        Budget::count();
+        frame.hot_loop->count_iteration();
 
-        if (stmt.type == StatementType::WHILE)
-            return execute_block(interpreter, stmt);
+        if (!frame.hot_loop->tier_up() && evaluate_condition(*frame.loop_scope, *frame.loop))
+        {
+            ++Interpreter::block_lvl;
+            ++frame.iterations;
+            frame.pc = 0;
+            return;
+        }
+    }
+    else if (looping && frame.for_each != nullptr && frame.next_element())
+    {
+        ++Interpreter::block_lvl;
+        ++frame.iterations;
+        frame.pc = 0;
+        return;
     }
 
-    return gvl::Interpreter::Info();
+    if (frame.trace_category != nullptr)
+        Tracer::record(frame.trace_category, frame.trace_name, frame.trace_line, frame.trace_begin, frame.iterations);
+
+    frames.pop_back();
 }
 
-static void add_element_in_array(const gvl::Interpreter& interpreter, gvl::VarLike& array, const gvl::Token& element)
+void gvl::Interpreter::push_call(CallStack& frames, const Statement& stmt, const Interpreter* caller)
 {
-    if (!element.empty())
-        array.array_elements.push_back(element);
-} 
+    const Statement* func = find_function(stmt.line[1]);
 
-gvl::Interpreter::Info gvl::Interpreter::execute_array_init(Interpreter& interpreter, const Statement& stmt)
-{
-    VarLike array;
-    array.name = stmt.line[1];
-    array.value = array.name;
-    array.type = VarLikeType::ARRAY;
-    array.is_const = false;
+    if (func == nullptr)
+        throw RunTimeError(ErrorCode::UNDEFINED_FUNCTION, "call of undefined function '" + stmt.line[1] + "'", stmt.line_no);
 
-    const Token index = get_varlike_value(interpreter, stmt.expression.right);
+    // a tail call pops the frames stmt belongs to
+    const std::size_t line_no = stmt.line_no;
+    const auto bind = [caller](const Token& token) -> const Token& { return caller != nullptr ? caller->bound(token) : token; };
 
-    if (!interpreter.variables.contains(array.name))
+    std::array<Token, 3> arguments{ bind(stmt.expression.left), bind(stmt.expression.middle), bind(stmt.expression.right) };
+    std::vector<std::pair<std::size_t, VarLike>> moved;
+    std::vector<PendingMemo> memos;
+
+    PendingMemo memo{ Parser::is_pure_function(*func) ? find_memo(stmt.line[1]) : nullptr, Token(), arguments, {} };
+
+    if (memo.cache != nullptr && memo_key(arguments, memo.key, memo.is_variable))
     {
-        if (stmt.expression.left.compare("$array_at") == 0)
-        {
-            const auto& right_side_array_name = 
-            interpreter.get_var_map().at(stmt.expression.middle).array_elements.at(std::stoi(index));
+        std::vector<Token> results;
 
-            for (const auto& array_elem : interpreter.get_var_map().at(right_side_array_name).array_elements)
-                add_element_in_array(interpreter, array, get_varlike_value(interpreter, array_elem));
-        }
-        else if (stmt.expression.left.compare("$array_pop") == 0)
+        if (memo.cache->lookup(memo.key, results))
         {
-            const auto& right_side_array_name = interpreter.get_var_map().at(stmt.expression.middle).array_elements.back();
-            
-            for (const auto& array_elem : interpreter.get_var_map().at(right_side_array_name).array_elements)
-                add_element_in_array(interpreter, array, get_varlike_value(interpreter, array_elem));
-            
-            const_cast<std::vector<Token>&> (interpreter.get_var_map().at(stmt.expression.middle).array_elements).pop_back();
+            apply_memo(arguments, results);
+            return;
         }
-        else
-        {
-            add_element_in_array(interpreter, array, get_varlike_value(interpreter, stmt.expression.left));
+    }
+    else
+        memo.cache = nullptr;
+
+    // a call that nothing follows in its function is a tail call: the caller's activation is over, so it is
+    // replaced instead of stacked, and the caller's own variables passed as arguments are moved to the callee
+    std::size_t tail = frames.size();
+
+    for (std::size_t i = frames.size(); i-- > 0;)
+    {
+        const Frame& frame = frames[i];
+        const ExePlan& plan = frame.scope->exe_plan;
+        const bool done = frame.pc == plan.size() || plan[frame.pc].first.type == StatementType::RETURN;
+
+        if (!done || frame.loop != nullptr || frame.for_each != nullptr || !frame.owned_scope)
+            break;
+
+        // a generator's frame stays at the bottom of its stack, its yields are the ones handed out
+        if (frame.function)
+        {
+            if (!Parser::is_generator_function(frame.function->function))
+                tail = i;
+            break;
+        }
+    }
+
+    if (tail < frames.size())
+    {
+        const Token& suffix = frames[tail].suffix;
+
+        for (std::size_t i = 0; i < arguments.size(); ++i)
+        {
+            const auto it = arguments[i].ends_with(suffix) ? variables.find(arguments[i]) : variables.end();
+
+            if (it != variables.end())
+                moved.emplace_back(i, std::move(it->second));
+        }
+
+        memos = std::exchange(frames[tail].memos, {});
+
+        while (frames.size() > tail)
+            finish_frame(frames, false);
+    }
+
+    Frame& frame = frames.emplace_back();
+    frame.suffix = "@" + std::to_string(++activations_no);
+    frame.function = bind_function(*func);
+
+    const std::array<const Token*, 3> params{ &func->expression.left, &func->expression.middle, &func->expression.right };
+
+    for (auto& [ i, varlike ] : moved)
+        arguments[i] = *params[i] + frame.suffix;
+
+    frame.slots = name_slots(*frame.function, arguments, frame.suffix);
+
+    ++Interpreter::block_lvl;
+    frame.owned_scope.reset(new Interpreter(frame.function->function.main_body));
+    frame.scope = frame.owned_scope.get();
+    frame.scope->slots = &frame.slots;
+    frame.trace("call", Parser::get_function_name(frame.function->function), line_no);
+
+    for (auto& [ i, varlike ] : moved)
+    {
+        varlike.name = frame.slots[i];
+
+        variables[varlike.name] = std::move(varlike);
+        frame.scope->tmp_var_names.push_back(frame.slots[i]);
+    }
+
+    frame.memos = std::move(memos);
+
+    if (memo.cache != nullptr)
+    {
+        memo.arguments = arguments;
+        frame.memos.push_back(std::move(memo));
+    }
+}
+
+bool gvl::Interpreter::run(CallStack& frames, Token* yielded)
+{
+    // the statement the top frame was running when it failed, or the loop whose condition or next element failed
+    const auto line_no = [&frames]() -> std::size_t
+    {
+        if (frames.empty())
+            return 0;
+
+        const Frame& frame = frames.back();
+        const Statement* loop = frame.loop != nullptr ? frame.loop : frame.for_each;
+
+        if ((frame.pc == 0 || frame.pc == frame.scope->exe_plan.size()) && loop != nullptr)
+            return loop->line_no;
+
+        return frame.pc > 0 ? frame.scope->exe_plan[frame.pc - 1].first.line_no : 0;
+    };
+
+    try
+    {
+        return run_frames(frames, yielded);
+    }
+    catch (...)
+    {
+        rethrow_runtime_error(line_no());
+    }
+}
+
+void gvl::Interpreter::rethrow_runtime_error(std::size_t line_no)
+{
+    try
+    {
+        throw;
+    }
+    catch (RunTimeError& error)
+    {
+        error.set_line_no(line_no);
+        throw;
+    }
+    catch (const std::out_of_range& error)
+    {
+        throw RunTimeError(ErrorCode::INDEX_OUT_OF_RANGE, error.what(), line_no);
+    }
+    catch (const std::invalid_argument&)
+    {
+        throw RunTimeError(ErrorCode::INVALID_NUMBER, "operand is not a number", line_no);
+    }
+    catch (const Calculator::Exception& error)
+    {
+        throw RunTimeError(ErrorCode::INVALID_EXPRESSION, error.what().empty() ? "invalid expression" : error.what(), line_no);
+    }
+    catch (const std::runtime_error& error)
+    {
+        throw RunTimeError(ErrorCode::FAILED_OPERATION, error.what(), line_no);
+    }
+}
+
+bool gvl::Interpreter::run_frames(CallStack& frames, Token* yielded)
+{
+    while (!frames.empty())
+    {
+        Frame& frame = frames.back();
+
+        if (frame.pc == frame.scope->exe_plan.size())
+        {
+            finish_frame(frames);
+            continue;
+        }
+
+        const auto& [ stmt, f ] = frame.scope->exe_plan[frame.pc++];
+        Budget::count();
+
+        if (stmt.type == StatementType::DEF_FUNC)
+            register_function(const_cast<Statement&>(stmt));
+        else if (stmt.type == StatementType::IF)
+        {
+            if (evaluate_condition(*frame.scope, stmt))
+            {
+                push_block(frames, stmt.main_body);
+                frames.back().trace("block", stmt.line.front(), stmt.line_no);
+            }
+        }
+        else if (stmt.type == StatementType::WHILE)
+        {
+            auto hot_loop = std::make_unique<Jit::HotLoop>(*frame.scope, stmt);
+
+            if (!hot_loop->tier_up() && evaluate_condition(*frame.scope, stmt))
+            {
+                Interpreter& loop_scope = *frame.scope;
+                push_block(frames, stmt.main_body);
+
+                frames.back().loop = &stmt;
+                frames.back().loop_scope = &loop_scope;
+                frames.back().hot_loop = std::move(hot_loop);
+                frames.back().trace("block", stmt.line.front(), stmt.line_no);
+            }
+        }
+        else if (stmt.type == StatementType::FOR_LINES || stmt.type == StatementType::FOR_GENERATOR)
+        {
+            Interpreter& loop_scope = *frame.scope;
+            push_block(frames, stmt.main_body);
+
+            Frame& loop = frames.back();
+            loop.for_each = &stmt;
+            loop.loop_scope = &loop_scope;
+            loop.trace("block", stmt.line.front(), stmt.line_no);
+
+            if (stmt.type == StatementType::FOR_LINES)
+                loop.lines = std::make_unique<LineReader>(open_lines(loop_scope, stmt));
+            else
+                loop.generator = std::make_unique<Generator>(open_generator(loop_scope, stmt));
+
+            if (!loop.next_element())
+            {
+                loop.iterations = 0;
+                finish_frame(frames, false);
+            }
+        }
+        else if (stmt.type == StatementType::YIELD)
+        {
+            // yields of generators run by a plain call, or called by the generator, are dropped
+            std::size_t function = frames.size();
+
+            for (std::size_t i = frames.size(); i-- > 0;)
+            {
+                if (frames[i].function)
+                {
+                    function = i;
+                    break;
+                }
+            }
+
+            if (yielded != nullptr && function == 0)
+            {
+                *yielded = get_value_and_type(stmt.expression.left, *frame.scope).first;
+                return true;
+            }
+        }
+        else if (stmt.type == StatementType::CALL_FUNC)
+            push_call(frames, stmt, frame.scope);
+        else if (f)
+            f(*frame.scope, stmt);
+        else
+        {
+            // return leaves the innermost function, outside of functions it ends the block like else does
+            std::size_t function = frames.size();
+
+            for (std::size_t i = frames.size(); stmt.type == StatementType::RETURN && i-- > 0;)
+            {
+                if (frames[i].function)
+                {
+                    function = i;
+                    break;
+                }
+            }
+
+            if (function == frames.size())
+                finish_frame(frames);
+
+            while (frames.size() > function)
+                finish_frame(frames, false);
+        }
+    }
+
+    return false;
+}
+
+void gvl::Interpreter::execute_body(Interpreter& interpreter, const Program::StmtContainer& body)
+{
+    ++Interpreter::block_lvl;
+    Interpreter sub(body);
+    sub.slots = interpreter.slots;
+    sub.execute_program();
+    --Interpreter::block_lvl;
+    
+    clear_scope(sub, sub.tmp_var_names);
+}
+
+gvl::Interpreter::Info gvl::Interpreter::execute_block(Interpreter& interpreter, const Statement& stmt)
+{
+    // spawned tasks run their function's definition as a block
+    const bool task = stmt.type == StatementType::DEF_FUNC;
+    Tracer::Span span(task ? "task" : "block", task ? Parser::get_function_name(stmt) : stmt.line.front(), stmt.line_no);
+    Jit::HotLoop hot_loop(interpreter, stmt);
+    std::size_t iterations = 0;
+
+    for (;;)
+    {
+        if (stmt.type == StatementType::WHILE && hot_loop.tier_up())
+            break;
+
+        if (!evaluate_condition(interpreter, stmt))
+            break;
+
+        execute_body(interpreter, stmt.main_body);
+        span.set_iterations(++iterations);
+
+        if (stmt.type != StatementType::WHILE)
+            break;
+
+        Budget::count();
+        hot_loop.count_iteration();
+    }
+
+    return gvl::Interpreter::Info();
+}
+
+static gvl::Token unquote(gvl::Token token)
+{
+    if (token.size() >= 2 && (token.front() == '\'' || token.front() == '"') && token.back() == token.front())
+        return token.substr(1, token.size() - 2);
+
+    return token;
+}
+
+gvl::LineReader gvl::Interpreter::open_lines(const Interpreter& interpreter, const Statement& stmt)
+{
+    if (stmt.expression.middle == "stdin")
+        return LineReader(interpreter.get_input_stream());
+
+    return LineReader(unquote(get_varlike_value(interpreter, stmt.expression.right)));
+}
+
+void gvl::Interpreter::set_line(Interpreter& interpreter, TokenSv name, std::string_view line)
+{
+    name = interpreter.bound(name);
+    auto it = interpreter.variables.find(name);
+
+    if (it == interpreter.variables.end())
+    {
+        VarLike varlike;
+        varlike.name = name;
+        it = interpreter.variables.emplace(name, varlike).first;
+
+        if (Interpreter::block_lvl > 0)
+            interpreter.tmp_var_names.push_back(name);
+    }
+
+    it->second.value.assign(line);
+    it->second.type = get_varlike_type(line);
+}
+
+gvl::Generator gvl::Interpreter::open_generator(const Interpreter& interpreter, const Statement& stmt)
+{
+    // the generator's body only starts on the first value, the loop is the place to report it missing
+    if (find_function(stmt.expression.middle) == nullptr)
+        throw RunTimeError(ErrorCode::UNDEFINED_FUNCTION, "generator loop over undefined function '" + stmt.expression.middle + "'",
+            stmt.line_no);
+
+    Statement call;
+    call.type = StatementType::CALL_FUNC;
+    call.line = { "call", stmt.expression.middle };
+    call.line_no = stmt.line_no;
+
+    // the arguments follow the generator's name, up to the block's '{'
+    std::array<Token*, 3> arguments{ &call.expression.left, &call.expression.middle, &call.expression.right };
+
+    for (std::size_t i = 5; i + 1 < stmt.line.size(); ++i)
+    {
+        call.line.push_back(interpreter.bound(stmt.line[i]));
+        *arguments[i - 5] = call.line.back();
+    }
+
+    return generate(std::move(call));
+}
+
+gvl::Generator gvl::Interpreter::generate(Statement call)
+{
+    CallStack frames;
+
+    // a generator its loop leaves early drops its variables like a finished one
+    struct Unwind
+    {
+        CallStack& frames;
+
+        ~Unwind()
+        {
+            while (!frames.empty())
+                finish_frame(frames, false);
+        }
+    } unwind{ frames };
+
+    push_call(frames, call, nullptr);
+
+    Token value;
+    while (run(frames, &value))
+        co_yield std::move(value);
+}
+
+static void add_element_in_array(const gvl::Interpreter& interpreter, gvl::VarLike& array, const gvl::Token& element)
+{
+    if (!element.empty())
+        array.array_elements.push_back(element);
+} 
+
+gvl::Interpreter::Info gvl::Interpreter::execute_array_init(Interpreter& interpreter, const Statement& stmt)
+{
+    VarLike array;
+    array.name = interpreter.bound(stmt.line[1]);
+    array.value = array.name;
+    array.type = VarLikeType::ARRAY;
+    array.is_const = false;
+
+    const Token index = get_varlike_value(interpreter, stmt.expression.right);
+
+    if (!interpreter.variables.contains(array.name))
+    {
+        if (stmt.expression.left.compare("$array_at") == 0)
+        {
+            const auto& right_side_array_name = 
+            variable_at(interpreter.get_var_map(), interpreter.bound(stmt.expression.middle)).array_elements.at(to_index(index));
+
+            // elements were resolved to values when they were stored, the inner array is shared as it is
+            array.array_elements = variable_at(interpreter.get_var_map(), right_side_array_name).array_elements;
+        }
+        else if (stmt.expression.left.compare("$array_slice") == 0)
+        {
+            const Token end = get_varlike_value(interpreter, stmt.line[6]);
+
+            const ArrayStorage& source = variable_at(interpreter.get_var_map(), interpreter.bound(stmt.expression.middle)).array_elements;
+            array.array_elements = ArrayStorage::slice(source, to_index(index), to_index(end));
+        }
+        else if (stmt.expression.left.compare("$array_load") == 0)
+        {
+            Tracer::Span span("io", stmt.expression.left, stmt.line_no);
+            array.array_elements = ArrayIO::load(unquote(get_varlike_value(interpreter, stmt.expression.middle)),
+                get_varlike_value(interpreter, stmt.expression.right));
+        }
+        else if (stmt.expression.left.compare("$array_pop") == 0)
+        {
+            ArrayStorage& outer = variable_at(interpreter.variables, interpreter.bound(stmt.expression.middle)).array_elements;
+
+            if (outer.empty())
+                throw RunTimeError(ErrorCode::EMPTY_ARRAY, "pop from empty array '" + interpreter.bound(stmt.expression.middle) + "'");
+
+            array.array_elements = variable_at(interpreter.get_var_map(), outer.back()).array_elements;
+            outer.pop_back();
+        }
+        else if (stmt.expression.left.compare("$dict_keys") == 0 || stmt.expression.left.compare("$dict_values") == 0)
+        {
+            const Dict& dict = variable_at(interpreter.get_var_map(), interpreter.bound(stmt.expression.middle)).dict_entries;
+            const bool keys = stmt.expression.left.compare("$dict_keys") == 0;
+            std::vector<Token> elements;
+
+            elements.reserve(dict.size());
+            for (const Dict::Entry& entry : dict)
+                elements.push_back(keys ? entry.key : entry.value);
+
+            array.array_elements = std::move(elements);
+        }
+        else if (stmt.expression.left.compare("$array_unique") == 0)
+            array.array_elements = ArrayOps::unique(
+                variable_at(interpreter.get_var_map(), interpreter.bound(stmt.expression.middle)).array_elements);
+        else if (stmt.expression.left.compare("$str_split") == 0)
+        {
+            Token text, separator;
+            array.array_elements = StrOps::split(string_operand(interpreter, stmt.expression.middle, text),
+                string_operand(interpreter, stmt.expression.right, separator));
+        }
+        else if (const auto original = stmt.line.size() == 4 ? interpreter.variables.find(interpreter.bound(stmt.expression.left)) :
+                     interpreter.variables.end();
+                 original != interpreter.variables.end())
+        {
+            // var[] copy = original shares the elements until either side is written to
+            array.array_elements = original->second.array_elements;
+        }
+        else
+        {
+            add_element_in_array(interpreter, array, get_varlike_value(interpreter, stmt.expression.left));
             add_element_in_array(interpreter, array, get_varlike_value(interpreter, stmt.expression.middle));
             add_element_in_array(interpreter, array, get_varlike_value(interpreter, stmt.expression.right));
         }
 
-        interpreter.variables[array.name] = array;
-        
-        if (Interpreter::block_lvl > 0)
-            interpreter.tmp_var_names.push_back(array.name);
+        // shared elements cost nothing, those a statement made up are new
+        if (!array.array_elements.is_shared())
+            Budget::allocate(array.array_elements.size() * sizeof(Token));
+
+        interpreter.variables[array.name] = std::move(array);
+        
+        if (Interpreter::block_lvl > 0)
+            interpreter.tmp_var_names.push_back(array.name);
+    }
+
+    return gvl::Interpreter::Info();
+}
+
+gvl::Interpreter::Info gvl::Interpreter::execute_array_set(Interpreter& interpreter, const Statement& stmt)
+{
+    const VarLike& target_array = variable_at(interpreter.get_var_map(), interpreter.bound(stmt.expression.left));
+
+    if (!target_array.is_const)
+    {
+        const Token& idx(get_varlike_value(interpreter, stmt.expression.middle));
+        const Token& set_value(get_varlike_value(interpreter, stmt.expression.right));
+        
+        const_cast<ArrayStorage&> (target_array.array_elements).set(to_index(idx), set_value);
+    }
+
+    return gvl::Interpreter::Info();
+}
+
+gvl::Interpreter::Info gvl::Interpreter::execute_array_save(Interpreter& interpreter, const Statement& stmt)
+{
+    Tracer::Span span("io", stmt.line.front(), stmt.line_no);
+    ArrayIO::save(variable_at(interpreter.get_var_map(), interpreter.bound(stmt.expression.left)).array_elements,
+        unquote(get_varlike_value(interpreter, stmt.expression.middle)), get_varlike_value(interpreter, stmt.expression.right));
+
+    return gvl::Interpreter::Info();
+}
+
+gvl::Interpreter::Info gvl::Interpreter::execute_array_sort(Interpreter& interpreter, const Statement& stmt)
+{
+    VarLike& varlike = variable_at(interpreter.variables, interpreter.bound(stmt.expression.left));
+
+    if (!varlike.is_const)
+        ArrayOps::sort(varlike.array_elements, stmt.expression.middle == "desc");
+
+    return gvl::Interpreter::Info();
+}
+
+gvl::Interpreter::Info gvl::Interpreter::execute_array_append(Interpreter& interpreter, const Statement& stmt)
+{
+    VarLike& varlike = variable_at(interpreter.variables, interpreter.bound(stmt.line[1]));
+    const Token value = get_varlike_value(interpreter, stmt.expression.middle);
+
+    Budget::allocate(sizeof(Token) + value.size());
+    varlike.array_elements.push_back(value);
+
+    return gvl::Interpreter::Info();
+}
+
+gvl::Interpreter::Info gvl::Interpreter::execute_array_pop(Interpreter& interpreter, const Statement& stmt)
+{
+    VarLike& varlike = variable_at(interpreter.variables, interpreter.bound(stmt.line[1]));
+    const auto& result = get_varlike_value(interpreter, stmt.expression.middle);
+
+    const auto count = interpreter.variables.find(result);
+
+    // an array argument pops as many elements as it has, anything else one
+    if (count == interpreter.variables.end())
+        varlike.array_elements.pop_back();
+    else
+    {
+        for (std::size_t i = 0; i < count->second.array_elements.size(); ++i)
+            varlike.array_elements.pop_back();
+    }
+
+    return gvl::Interpreter::Info();
+}
+
+static void rename_token(gvl::Token& token, const std::unordered_map<gvl::Token, gvl::Token>& params)
+{
+    const auto& it = params.find(token);
+
+    if (it != params.end())
+    {
+        token = it->second;
+        return;
+    }
+
+    // reduce clauses of pfor statements, e.g. sum:total
+    const std::size_t colon = token.find(':');
+
+    if (colon != gvl::Token::npos && params.contains(token.substr(colon + 1)))
+        token = token.substr(0, colon + 1) + params.at(token.substr(colon + 1));
+}
+
+static void bind_parameters(std::vector<gvl::Statement>& body, const std::unordered_map<gvl::Token, gvl::Token>& params)
+{
+    for (gvl::Statement& sub_stmt : body)
+    {
+        for (gvl::Token& token : sub_stmt.line)
+            rename_token(token, params);
+
+        rename_token(sub_stmt.expression.left, params);
+        rename_token(sub_stmt.expression.middle, params);
+        rename_token(sub_stmt.expression.right, params);
+
+        bind_parameters(sub_stmt.main_body, params);
+        bind_parameters(sub_stmt.second_body, params);
+    }
+}
+
+static void collect_locals(const std::vector<gvl::Statement>& body, std::set<gvl::Token>& locals)
+{
+    using gvl::StatementType;
+
+    for (const gvl::Statement& stmt : body)
+    {
+        if (stmt.type == StatementType::INIT || stmt.type == StatementType::CONST || stmt.type == StatementType::ARRAY_INIT ||
+            stmt.type == StatementType::DICT_INIT)
+            locals.insert(stmt.line[1]);
+        else if (stmt.type == StatementType::PFOR || stmt.type == StatementType::FOR_LINES ||
+                 stmt.type == StatementType::FOR_GENERATOR)
+            locals.insert(stmt.expression.left);
+
+        collect_locals(stmt.main_body, locals);
+        collect_locals(stmt.second_body, locals);
+    }
+}
+
+void gvl::Interpreter::bind_frame(Statement& func_copy, const std::array<Token, 3>& arguments, TokenSv suffix)
+{
+    std::unordered_map<Token, Token> names;
+    std::set<Token> locals;
+
+    collect_locals(func_copy.main_body, locals);
+    for (const Token& local : locals)
+        names.emplace(local, local + Token(suffix));
+
+    const std::array<const Token*, 3> params{ &func_copy.expression.left, &func_copy.expression.middle, &func_copy.expression.right };
+
+    for (std::size_t i = 0; i < params.size(); ++i)
+    {
+        if (!params[i]->empty() && !arguments[i].empty())
+            names[*params[i]] = arguments[i];
+    }
+
+    bind_parameters(func_copy.main_body, names);
+}
+
+// like bind_parameters, functions defined in the body bind their own names
+static void bind_slots(std::vector<gvl::Statement>& body, const std::unordered_map<gvl::Token, gvl::Token>& slots)
+{
+    for (gvl::Statement& sub_stmt : body)
+    {
+        if (sub_stmt.type == gvl::StatementType::DEF_FUNC)
+            continue;
+
+        for (gvl::Token& token : sub_stmt.line)
+            rename_token(token, slots);
+
+        rename_token(sub_stmt.expression.left, slots);
+        rename_token(sub_stmt.expression.middle, slots);
+        rename_token(sub_stmt.expression.right, slots);
+
+        bind_slots(sub_stmt.main_body, slots);
+        bind_slots(sub_stmt.second_body, slots);
+    }
+}
+
+std::shared_ptr<const gvl::Interpreter::BoundFunction> gvl::Interpreter::bind_function(const Statement& func)
+{
+    std::lock_guard<std::mutex> lock(context->functions_mutex);
+    std::shared_ptr<const BoundFunction>& cached = context->bound_funcs[&func];
+
+    if (cached)
+        return cached;
+
+    auto bound = std::make_shared<BoundFunction>();
+    bound->function = func;
+
+    std::set<Token> locals;
+    collect_locals(func.main_body, locals);
+
+    const std::array<const Token*, 3> params{ &func.expression.left, &func.expression.middle, &func.expression.right };
+    std::unordered_map<Token, Token> slots;
+
+    for (std::size_t i = 0; i < params.size(); ++i)
+    {
+        bound->names.push_back(*params[i]);
+        bound->declared[i] = locals.contains(*params[i]);
+
+        if (!params[i]->empty())
+            slots[*params[i]] = slot_mark + std::to_string(i);
     }
 
-    return gvl::Interpreter::Info();
+    for (const Token& local : locals)
+    {
+        if (slots.emplace(local, slot_mark + std::to_string(bound->names.size())).second)
+            bound->names.push_back(local);
+    }
+
+    bind_slots(bound->function.main_body, slots);
+    cached = std::move(bound);
+
+    return cached;
 }
 
-gvl::Interpreter::Info gvl::Interpreter::execute_array_set(Interpreter& interpreter, const Statement& stmt)
+std::vector<gvl::Token> gvl::Interpreter::name_slots(const BoundFunction& bound, const std::array<Token, 3>& arguments, TokenSv suffix)
 {
-    const VarLike& target_array = interpreter.get_var_map().at(stmt.expression.left);
+    std::vector<Token> slots;
+    slots.reserve(bound.names.size());
 
-    if (!target_array.is_const)
+    // a parameter without an argument is the variable of its name, or the local the body declares of it
+    for (std::size_t i = 0; i < bound.names.size(); ++i)
     {
-        const Token& idx(get_varlike_value(interpreter, stmt.expression.middle));
-        const Token& set_value(get_varlike_value(interpreter, stmt.expression.right));
-        
-        const std::vector<Token>& target_array_values(target_array.array_elements);
-        const_cast<std::vector<Token>&> (target_array_values).at(std::stoi(idx)) = set_value;
+        if (i < arguments.size() && !arguments[i].empty())
+            slots.push_back(arguments[i]);
+        else if (i < arguments.size() && !bound.declared[i])
+            slots.push_back(bound.names[i]);
+        else
+            slots.push_back(bound.names[i] + Token(suffix));
     }
 
-    return gvl::Interpreter::Info();
+    return slots;
 }
 
-gvl::Interpreter::Info gvl::Interpreter::execute_array_append(Interpreter& interpreter, const Statement& stmt)
+static std::size_t slot_of(gvl::TokenSv token)
+{
+    std::size_t slot = 0;
+    std::from_chars(token.data() + 1, token.data() + token.size(), slot);
+
+    return slot;
+}
+
+gvl::TokenSv gvl::Interpreter::bound(TokenSv token) const
+{
+    if (this->slots == nullptr || token.empty() || token.front() != slot_mark)
+        return token;
+
+    return (*this->slots)[slot_of(token)];
+}
+
+const gvl::Token& gvl::Interpreter::bound(const Token& token) const
+{
+    if (this->slots == nullptr || token.empty() || token.front() != slot_mark)
+        return token;
+
+    return (*this->slots)[slot_of(token)];
+}
+
+void gvl::Interpreter::bind_arguments(Statement& func_stmt, const Statement& stmt)
+{
+    std::unordered_map<Token, Token> params;
+
+    if (!stmt.expression.left.empty())
+        params.insert(std::pair<Token, Token>(func_stmt.expression.left, stmt.expression.left));
+    if (!stmt.expression.middle.empty())
+        params.insert(std::pair<Token, Token>(func_stmt.expression.middle, stmt.expression.middle));
+    if (!stmt.expression.right.empty())
+        params.insert(std::pair<Token, Token>(func_stmt.expression.right, stmt.expression.right)); 
+
+    bind_parameters(func_stmt.main_body, params);
+}
+
+void gvl::Interpreter::register_function(Statement& func_stmt)
+{
+    const Token& name = Parser::get_function_name(func_stmt);
+
+    std::lock_guard<std::mutex> lock(context->functions_mutex);
+    const auto previous = context->ud_funcs.find(name);
+    const bool redefined = previous != context->ud_funcs.end() && previous->second != &func_stmt;
+
+    // the bodies bound for a replaced definition are only kept by the frames still running them
+    if (previous == context->ud_funcs.end() || redefined)
+    {
+        if (redefined)
+            context->bound_funcs.erase(previous->second);
+        context->bound_funcs.erase(&func_stmt);
+    }
+
+    // the key views the name in the newest definition, which may outlive the one it replaces
+    context->ud_funcs.erase(name);
+    context->ud_funcs.emplace(name, &func_stmt);
+
+    if (!Parser::is_pure_function(func_stmt))
+        return;
+
+    // results of a previous body are not results of this one
+    const auto cache = context->memo_caches.find(name);
+
+    if (cache == context->memo_caches.end())
+        context->memo_caches.emplace(name, std::make_unique<MemoCache>(MemoCache::get_default_capacity()));
+    else if (redefined)
+        cache->second->clear();
+}
+
+const gvl::Statement* gvl::Interpreter::find_function(TokenSv name)
+{
+    std::lock_guard<std::mutex> lock(context->functions_mutex);
+
+    const auto it = context->ud_funcs.find(name);
+
+    if (it == context->ud_funcs.end())
+        return nullptr;
+
+    // a body the optimizer did not need is parsed by the first call, whose line its syntax errors are reported at
+    try
+    {
+        Parser::parse_function_body(*it->second);
+    }
+    catch (const Parser::ParseTimeError& e)
+    {
+        throw RunTimeError(ErrorCode::SYNTAX_ERROR, "syntax error in function '" + Token(name) + "' at line " +
+            std::to_string(e.get_line_no()) + ": " + e.get_message());
+    }
+
+    return it->second;
+}
+
+gvl::MemoCache* gvl::Interpreter::find_memo(TokenSv name)
 {
-    VarLike& varlike = interpreter.variables.at(stmt.line[1]);
-    varlike.array_elements.push_back(get_varlike_value(interpreter, stmt.expression.middle));
+    std::lock_guard<std::mutex> lock(context->functions_mutex);
+
+    const auto it = context->memo_caches.find(name);
+
+    return it != context->memo_caches.end() ? it->second.get() : nullptr;
+}
+
+bool gvl::Interpreter::memo_key(const std::array<Token, 3>& arguments, Token& key, std::array<bool, 3>& is_variable)
+{
+    key.clear();
+
+    for (std::size_t i = 0; i < arguments.size(); ++i)
+    {
+        const auto it = variables.find(arguments[i]);
+        is_variable[i] = it != variables.end();
+
+        if (is_variable[i] && (it->second.type == VarLikeType::ARRAY || it->second.type == VarLikeType::DICT))
+            return false;
+
+        // separators can not be part of a token, literals are marked as their parameters can not be written to
+        if (!is_variable[i])
+            key += '\x1e';
+        key += is_variable[i] ? it->second.value : arguments[i];
+        key += '\x1f';
+    }
+
+    return true;
+}
+
+bool gvl::Interpreter::memo_results(const std::array<Token, 3>& arguments, const std::array<bool, 3>& is_variable,
+    std::vector<Token>& results)
+{
+    results.assign(arguments.size(), Token());
+
+    for (std::size_t i = 0; i < arguments.size(); ++i)
+    {
+        if (!is_variable[i])
+            continue;
+
+        const auto it = variables.find(arguments[i]);
+
+        if (it == variables.end() || it->second.type == VarLikeType::ARRAY || it->second.type == VarLikeType::DICT)
+            return false;
+
+        results[i] = it->second.value;
+    }
+
+    return true;
+}
+
+void gvl::Interpreter::apply_memo(const std::array<Token, 3>& arguments, const std::vector<Token>& results)
+{
+    for (std::size_t i = 0; i < arguments.size(); ++i)
+    {
+        const auto it = variables.find(arguments[i]);
+
+        if (it == variables.end() || it->second.is_const)
+            continue;
+
+        it->second.value = results[i];
+        it->second.type = get_varlike_type(results[i]);
+    }
+}
+
+void gvl::Interpreter::print_memo_stats(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock(context->functions_mutex);
+
+    for (const auto& [ name, cache ] : context->memo_caches)
+        out << "memo " << name << ": " << cache->get_hits() << " hits, " << cache->get_misses() << " misses\n";
+}
+
+gvl::Interpreter::Info gvl::Interpreter::execute_call_func(Interpreter& interpreter, const Statement& stmt)
+{
+    CallStack frames;
+    push_call(frames, stmt, &interpreter);
+    run(frames);
 
     return gvl::Interpreter::Info();
 }
 
-gvl::Interpreter::Info gvl::Interpreter::execute_array_pop(Interpreter& interpreter, const Statement& stmt)
+namespace
 {
-    VarLike& varlike = interpreter.variables.at(stmt.line[1]);
-    const auto& result = get_varlike_value(interpreter, stmt.expression.middle);
+    // installs a private copy of the variables of a pfor caller or a task spawner, and its context, on the
+    // running thread, which may be a pool worker or a waiting thread helping out, and puts its own back afterwards
+    class WorkerScope
+    {
+        public:
+
+            WorkerScope(gvl::Interpreter::VarLikeMap& variables, std::array<gvl::Token, gvl::args_max_num>& args, std::size_t& block_lvl,
+                      const gvl::Interpreter::VarLikeMap& snapshot,
+                      const std::array<gvl::Token, gvl::args_max_num>& snapshot_args, gvl::Interpreter::Context* snapshot_context)
+                : variables(variables), args(args), block_lvl(block_lvl),
+                  saved_variables(std::exchange(variables, snapshot)), saved_args(std::exchange(args, snapshot_args)),
+                  saved_block_lvl(std::exchange(block_lvl, 0)), saved_context(gvl::Interpreter::get_context())
+            {
+                gvl::Interpreter::set_context(snapshot_context);
+            }
+
+            ~WorkerScope()
+            {
+                variables = std::move(saved_variables);
+                args = std::move(saved_args);
+                block_lvl = saved_block_lvl;
+                gvl::Interpreter::set_context(saved_context);
+            }
+
+        private:
+
+            gvl::Interpreter::VarLikeMap& variables;
+            std::array<gvl::Token, gvl::args_max_num>& args;
+            std::size_t& block_lvl;
+            gvl::Interpreter::VarLikeMap saved_variables;
+            std::array<gvl::Token, gvl::args_max_num> saved_args;
+            std::size_t saved_block_lvl;
+            gvl::Interpreter::Context* saved_context;
+    };
+}
+
+static gvl::Token merge_reduction(const gvl::Token& op, const gvl::Token& initial, const std::vector<gvl::Token>& partials)
+{
+    using gvl::VarLikeType;
 
-    try 
+    if (op == "sum")
     {
-        const auto& array_elemenets = interpreter.variables.at(result).array_elements;
-        if (!array_elemenets.empty())
+        bool is_double = get_varlike_type(initial) == VarLikeType::DOUBLE;
+        for (const gvl::Token& partial : partials)
+            is_double = is_double || get_varlike_type(partial) == VarLikeType::DOUBLE;
+
+        if (is_double)
         {
-            for (auto it = array_elemenets.begin(); it != array_elemenets.end(); ++it)
-                varlike.array_elements.pop_back();
+            double total = std::stod(initial);
+            for (const gvl::Token& partial : partials)
+                total += std::stod(partial);
+            return std::to_string(total);
         }
-    } catch (std::out_of_range&) 
+
+        long long total = std::stoll(initial);
+        for (const gvl::Token& partial : partials)
+            total += std::stoll(partial);
+        return std::to_string(total);
+    }
+
+    gvl::Token best = initial;
+    for (const gvl::Token& partial : partials)
     {
-        varlike.array_elements.pop_back();
+        if (op == "min" ? std::stod(partial) < std::stod(best) : std::stod(partial) > std::stod(best))
+            best = partial;
+    }
+
+    return best;
+}
+
+gvl::Interpreter::Info gvl::Interpreter::execute_pfor(Interpreter& interpreter, const Statement& stmt)
+{
+    const ArrayStorage elements = variable_at(interpreter.variables, interpreter.bound(stmt.expression.middle)).array_elements;
+    const std::vector<Parser::Reduction> reductions = Parser::get_pfor_reductions(stmt.line);
+    Tracer::Span span("block", stmt.line.front(), stmt.line_no);
+    span.set_iterations(elements.size());
+
+    // taken once, the caller's own map is swapped out while it helps running chunks
+    const VarLikeMap snapshot = interpreter.variables;
+    const std::array<Token, args_max_num> snapshot_args = interpreter.args;
+    Context* const caller_context = context;
+
+    ThreadPool& pool = ThreadPool::shared();
+    const std::size_t chunks = std::clamp<std::size_t>(4 * pool.get_threads_no(), 1, std::max<std::size_t>(elements.size(), 1));
+    std::vector<std::vector<Token>> partials(reductions.size(), std::vector<Token>(chunks));
+
+    pool.parallel_for(elements.size(), chunks, [&](std::size_t begin, std::size_t end, std::size_t chunk)
+    {
+        WorkerScope scope(variables, args, block_lvl, snapshot, snapshot_args, caller_context);
+        Tracer::Span chunk_span("pfor chunk", stmt.line.front(), stmt.line_no);
+        chunk_span.set_iterations(end - begin);
+
+        // every chunk starts its reductions from the identity, the outer value is folded in once when merging
+        for (const auto& [ op, name ] : reductions)
+        {
+            if (op == "sum")
+                variable_at(variables, interpreter.bound(name)).value = "0";
+        }
+
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            VarLike element;
+            element.name = interpreter.bound(stmt.expression.left);
+            element.value = elements[i];
+
+            const auto it = variables.find(elements[i]);
+
+            if (it != variables.end() && it->second.type == VarLikeType::ARRAY)
+            {
+                element.type = VarLikeType::ARRAY;
+                element.array_elements = it->second.array_elements;
+            }
+            else if (it != variables.end() && it->second.type == VarLikeType::DICT)
+            {
+                element.type = VarLikeType::DICT;
+                element.dict_entries = it->second.dict_entries;
+            }
+            else
+                element.type = get_varlike_type(elements[i]);
+
+            variables[element.name] = element;
+
+            execute_body(interpreter, stmt.main_body);
+        }
+
+        for (std::size_t r = 0; r < reductions.size(); ++r)
+            partials[r][chunk] = variable_at(variables, interpreter.bound(reductions[r].second)).value;
+    });
+
+    // chunk order keeps the result independent of scheduling
+    for (std::size_t r = 0; r < reductions.size(); ++r)
+    {
+        VarLike& target = variable_at(interpreter.variables, interpreter.bound(reductions[r].second));
+        target.value = merge_reduction(reductions[r].first, target.value, partials[r]);
+        target.type = get_varlike_type(target.value);
     }
 
     return gvl::Interpreter::Info();
 }
 
-gvl::Interpreter::Info gvl::Interpreter::execute_call_func(Interpreter& interpreter, const Statement& stmt)
+void gvl::Interpreter::set_handle(Interpreter& interpreter, TokenSv name, const Token& handle)
 {
-    const std::unordered_set<std::pair<TokenSv, Statement*>, HashTokenStmtPair>& udfs(interpreter.get_ud_funcs());
+    name = interpreter.bound(name);
+    const auto it = interpreter.variables.find(name);
 
-    auto it = std::find_if(udfs.begin(), udfs.end(), 
-        [stmt](const std::pair<TokenSv, Statement*>& p){ return p.first.compare(stmt.line[1]) == 0; });
-    
+    if (it != interpreter.variables.end())
+    {
+        it->second.value = handle;
+        return;
+    }
+
+    VarLike varlike;
+    varlike.name = name;
+    varlike.value = handle;
+    varlike.type = VarLikeType::STRING;
+
+    interpreter.variables[varlike.name] = varlike;
 
-    if (it != udfs.end())
+    if (Interpreter::block_lvl > 0)
+        interpreter.tmp_var_names.push_back(varlike.name);
+}
+
+gvl::Interpreter::Info gvl::Interpreter::execute_spawn(Interpreter& interpreter, const Statement& stmt)
+{
+    const Statement* func = find_function(stmt.expression.middle);
+
+    if (func == nullptr)
+        throw RunTimeError(ErrorCode::UNDEFINED_FUNCTION, "spawn of undefined function '" + stmt.expression.middle + "'");
+
+    auto task = std::make_shared<SpawnedTask>();
+    task->function = *func;
+    for (auto it = stmt.line.begin() + 4; it != stmt.line.end(); ++it)
+        task->outputs.push_back(interpreter.bound(*it));
+
+    Statement call;
+    call.type = StatementType::CALL_FUNC;
+    call.expression.left = task->outputs.size() > 0 ? task->outputs[0] : "";
+    call.expression.middle = task->outputs.size() > 1 ? task->outputs[1] : "";
+    call.expression.right = task->outputs.size() > 2 ? task->outputs[2] : "";
+    bind_arguments(task->function, call);
+
+    Token handle;
     {
-        Statement& func_stmt = *(it->second);
-        std::unordered_map<Token, Token> params;
+        std::lock_guard<std::mutex> lock(context->tasks_mutex);
+        handle = "task#" + std::to_string(++context->tasks_no);
+        context->tasks[handle] = task;
+    }
 
-        if (!stmt.expression.left.empty())
-            params.insert(std::pair<Token, Token>(func_stmt.expression.left, stmt.expression.left));
-        if (!stmt.expression.middle.empty())
-            params.insert(std::pair<Token, Token>(func_stmt.expression.middle, stmt.expression.middle));
-        if (!stmt.expression.right.empty())
-            params.insert(std::pair<Token, Token>(func_stmt.expression.right, stmt.expression.right)); 
+    set_handle(interpreter, stmt.expression.left, handle);
 
-        for (Statement& sub_stmt : func_stmt.main_body)
+    ThreadPool::shared().submit([task, snapshot = interpreter.variables, snapshot_args = interpreter.args, caller_context = context->shared_from_this()]()
+    {
+        try
         {
-            for (Token& token : sub_stmt.line)
+            WorkerScope scope(variables, args, block_lvl, snapshot, snapshot_args, caller_context.get());
+
+            Program program;
+            program.args = snapshot_args;
+            Interpreter task_interpreter(program);
+
+            execute_block(task_interpreter, task->function);
+
+            for (const Token& output : task->outputs)
             {
-                if (params.contains(token))
-                    token = params[token];
+                const auto it = variables.find(output);
+
+                if (it != variables.end())
+                    task->results.emplace_back(output, it->second);
             }
+        }
+        catch (...) { task->error = std::current_exception(); }
+
+        task->done = true;
+    });
+
+    return gvl::Interpreter::Info();
+}
+
+gvl::Interpreter::Info gvl::Interpreter::execute_await(Interpreter& interpreter, const Statement& stmt)
+{
+    const Token handle = get_varlike_value(interpreter, stmt.expression.left);
+    std::shared_ptr<SpawnedTask> task;
+
+    {
+        std::lock_guard<std::mutex> lock(context->tasks_mutex);
+        const auto it = context->tasks.find(handle);
+
+        if (it == context->tasks.end())
+            throw RunTimeError(ErrorCode::INVALID_HANDLE, "'" + handle + "' is not a task");
 
-            if (params.contains(sub_stmt.expression.left))
-                sub_stmt.expression.left = params[sub_stmt.expression.left];
-            if (params.contains(sub_stmt.expression.left))
-                sub_stmt.expression.middle = params[sub_stmt.expression.middle];
-            if (params.contains(sub_stmt.expression.right))
-                sub_stmt.expression.right = params[sub_stmt.expression.right];            
+        task = std::move(it->second);
+        context->tasks.erase(it);
+    }
+
+    {
+        Tracer::Span span("task", stmt.line.front(), stmt.line_no);
+        ThreadPool::shared().block_until([&task]() { return task->done.load(); });
+    }
+
+    if (task->error)
+        std::rethrow_exception(task->error);
+
+    // the task ran on a copy of the variables, its arguments are its results
+    for (const auto& [ name, result ] : task->results)
+    {
+        const auto it = interpreter.variables.find(name);
+
+        if (it == interpreter.variables.end())
+            continue;
+
+        VarLike& varlike = it->second;
+
+        if (!varlike.is_const)
+        {
+            varlike.value = result.value;
+            varlike.type = result.type;
+            varlike.array_elements = result.array_elements;
+            varlike.dict_entries = result.dict_entries;
         }
-        
-        interpreter.execute_block(interpreter, *(it->second));
     }
 
     return gvl::Interpreter::Info();
 }
 
+gvl::Interpreter::Info gvl::Interpreter::execute_channel_related(Interpreter& interpreter, const Statement& stmt)
+{
+    if (stmt.type == StatementType::CHANNEL_INIT)
+    {
+        const Token capacity = get_varlike_value(interpreter, stmt.expression.middle);
+        const Token handle = Channel::create(to_index(capacity));
+
+        {
+            std::lock_guard<std::mutex> lock(context->tasks_mutex);
+            context->channels.push_back(handle);
+        }
+
+        set_handle(interpreter, stmt.expression.left, handle);
+        return gvl::Interpreter::Info();
+    }
+
+    const Token handle = get_varlike_value(interpreter, stmt.expression.left);
+    std::shared_ptr<Channel> channel = Channel::find(handle);
+
+    if (!channel)
+        throw RunTimeError(ErrorCode::INVALID_HANDLE, "'" + handle + "' is not a channel");
+    ThreadPool& pool = ThreadPool::shared();
+    Tracer::Span span("channel", stmt.line.front(), stmt.line_no);
+
+    if (stmt.type == StatementType::CHANNEL_SEND)
+    {
+        const Token value = get_varlike_value(interpreter, stmt.expression.middle);
+        pool.block_until([&channel, &value]() { return channel->try_send(value); });
+    }
+    else if (stmt.type == StatementType::CHANNEL_RECV)
+    {
+        Token value;
+        Channel::Receive received = Channel::Receive::EMPTY;
+
+        pool.block_until([&]() { return (received = channel->try_receive(value)) != Channel::Receive::EMPTY; });
+
+        if (received == Channel::Receive::VALUE)
+        {
+            VarLike& varlike = variable_at(interpreter.variables, interpreter.bound(stmt.expression.middle));
+            varlike.value = value;
+            varlike.type = get_varlike_type(value);
+        }
+
+        if (!stmt.expression.right.empty())
+        {
+            // numeric, so that it can be tested by a while condition
+            VarLike& ok = variable_at(interpreter.variables, interpreter.bound(stmt.expression.right));
+            ok.value = received == Channel::Receive::VALUE ? "1" : "0";
+            ok.type = VarLikeType::INT;
+        }
+    }
+    else if (stmt.type == StatementType::CHANNEL_CLOSE)
+        channel->close();
+
+    return gvl::Interpreter::Info();
+}
+
+gvl::Interpreter::Info gvl::Interpreter::execute_dict_related(Interpreter& interpreter, const Statement& stmt)
+{
+    if (stmt.type == StatementType::DICT_INIT)
+    {
+        if (!interpreter.variables.contains(interpreter.bound(stmt.expression.left)))
+        {
+            VarLike dict;
+            dict.name = interpreter.bound(stmt.line[1]);
+            dict.value = dict.name;
+            dict.type = VarLikeType::DICT;
+
+            interpreter.variables[dict.name] = std::move(dict);
+
+            if (Interpreter::block_lvl > 0)
+                interpreter.tmp_var_names.push_back(interpreter.bound(stmt.line[1]));
+        }
+
+        return gvl::Interpreter::Info();
+    }
+
+    VarLike& dict = variable_at(interpreter.variables, interpreter.bound(stmt.expression.left));
+
+    if (dict.is_const)
+        return gvl::Interpreter::Info();
+
+    const Token key = dict_key(interpreter, stmt.expression.middle);
+
+    if (stmt.type == StatementType::DICT_SET)
+    {
+        const Token value = get_value_and_type(stmt.expression.right, interpreter).first;
+        Budget::allocate(sizeof(Dict::Entry) + key.size() + value.size());
+        dict.dict_entries.insert_or_assign(key, value);
+    }
+    else if (stmt.type == StatementType::DICT_REMOVE)
+        dict.dict_entries.erase(key);
+
+    return gvl::Interpreter::Info();
+}
+
+gvl::Interpreter::Info gvl::Interpreter::execute_checkpoint(Interpreter&, const Statement&)
+{
+    Snapshot::checkpoint();
+
+    return gvl::Interpreter::Info();
+}
+
 void gvl::Interpreter::clear_scope(gvl::Interpreter& interpreter, std::vector<TokenSv>& var_names)
 {
     for (const auto& var_name : var_names)
     {
-        try { Interpreter::variables.erase(var_name); }
-        catch (...) {}
+        Interpreter::variables.erase(var_name);
     }
 
     var_names.clear();
@@ -613,10 +2184,26 @@ static bool is_read_related(gvl::StatementType type)
             type == StatementType::READSTR;
 }
 
+static bool is_channel_related(gvl::StatementType type)
+{
+    using gvl::StatementType;
+    return type == StatementType::CHANNEL_INIT || type == StatementType::CHANNEL_SEND || 
+            type == StatementType::CHANNEL_RECV || type == StatementType::CHANNEL_CLOSE;
+}
+
+static bool is_dict_related(gvl::StatementType type)
+{
+    using gvl::StatementType;
+    return type == StatementType::DICT_INIT || type == StatementType::DICT_SET || type == StatementType::DICT_REMOVE;
+}
+
 gvl::Interpreter::Interpreter(const Program& program)
+    : Interpreter(program, program.args)
+{}
+
+gvl::Interpreter::Interpreter(const Program& program, const std::array<Token, args_max_num>& args)
 {
-    const Program::StmtContainer& stmts = program.statements;
-    this->args = program.args;
+    this->args = args;
 
     {
         VarLike vl;
@@ -634,6 +2221,16 @@ gvl::Interpreter::Interpreter(const Program& program)
         variables[vl.name] = vl;
     }
 
+    plan(program.statements);
+}
+
+gvl::Interpreter::Interpreter(const Program::StmtContainer& body)
+{
+    plan(body);
+}
+
+void gvl::Interpreter::plan(const Program::StmtContainer& stmts)
+{
     for (const Statement& stmt : stmts)
     {
         StatementType type = stmt.type;
@@ -644,8 +2241,16 @@ gvl::Interpreter::Interpreter(const Program& program)
         type == StatementType::ARRAY_APPEND ? f = execute_array_append :
         type == StatementType::ARRAY_POP ? f = execute_array_pop :
         type == StatementType::ARRAY_SET ? f = execute_array_set :
+        type == StatementType::ARRAY_SAVE ? f = execute_array_save :
+        type == StatementType::ARRAY_SORT ? f = execute_array_sort :
         type == StatementType::ASSIGN ? f = execute_assign :
         type == StatementType::CALL_FUNC ? f = execute_call_func :
+        type == StatementType::PFOR ? f = execute_pfor :
+        type == StatementType::SPAWN ? f = execute_spawn :
+        type == StatementType::AWAIT ? f = execute_await :
+        is_channel_related(stmt.type) ? f = execute_channel_related :
+        is_dict_related(stmt.type) ? f = execute_dict_related :
+        type == StatementType::CHECKPOINT ? f = execute_checkpoint :
         type == StatementType::PRINT || stmt.type == StatementType::PRINTLN ? f = execute_print_related :
         is_read_related(stmt.type) ? f = execute_read_related :
         type == StatementType::IF || type == StatementType::WHILE ? f = execute_block : f = nullptr;
@@ -656,13 +2261,7 @@ gvl::Interpreter::Interpreter(const Program& program)
 
 void gvl::Interpreter::execute_program()
 {
-    for (const auto& p : this->exe_plan)
-    {
-        if (p.first.type == StatementType::DEF_FUNC)
-            this->ud_funcs.insert(std::pair<TokenSv, Statement*>(const_cast<Token&>(p.first.line[1]), const_cast<Statement*>(&p.first)));
-        else if (p.second)
-            p.second(*this, p.first);
-        else
-            return;
-    }
+    CallStack frames;
+    frames.emplace_back().scope = this;
+    run(frames);
 }
\ No newline at end of file
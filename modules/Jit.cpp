@@ -0,0 +1,622 @@
+#include "../includes/Jit.hpp"
+#include "../includes/Interpreter.hpp"
+#include "../includes/Budget.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <initializer_list>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <sys/mman.h>
+#endif
+
+
+bool gvl::Jit::enabled = true;
+
+std::size_t gvl::Jit::hotness_threshold = gvl::Jit::default_hotness_threshold;
+
+
+bool gvl::Jit::HotLoop::tier_up()
+{
+    if (!enabled || attempted || iterations < hotness_threshold)
+        return false;
+
+    attempted = true;
+    const Outcome outcome = execute_loop(interpreter, loop);
+
+    // the budget was checked in between, the loop is compiled again once it is hot again
+    if (outcome == Outcome::OUT_OF_FUEL)
+    {
+        attempted = false;
+        iterations = 0;
+    }
+
+    return outcome == Outcome::FINISHED;
+}
+
+
+#if defined(__x86_64__)
+
+namespace
+{
+    // slots: every variable the loop touches, arrays/lengths: int snapshots of the arrays it reads, fuel: statements
+    // metered loops may run, every loop body takes its size at the top of each iteration.
+    // Returns 0 once the loop condition is false, otherwise the index + 1 of the resume point to continue from.
+    using NativeLoop = std::int32_t (*)(std::int32_t* slots, const std::int32_t* const* arrays, const std::int64_t* lengths,
+        std::int64_t* fuel);
+
+    enum Condition : std::uint8_t
+    {
+        ALWAYS = 0x00,
+        JAE = 0x83,
+        JE = 0x84,
+        JNE = 0x85,
+        JS = 0x88,
+        JL = 0x8C,
+        JGE = 0x8D,
+        JLE = 0x8E,
+        JG = 0x8F
+    };
+
+    class Assembler
+    {
+        public:
+
+            void emit(std::initializer_list<std::uint8_t> bytes) { code.insert(code.end(), bytes); }
+
+            void emit32(std::int32_t value)
+            {
+                for (int i = 0; i < 4; ++i)
+                    code.push_back(static_cast<std::uint8_t>(static_cast<std::uint32_t>(value) >> (8 * i)));
+            }
+
+            std::size_t emit_jump(Condition cond)
+            {
+                if (cond == ALWAYS)
+                    emit({ 0xE9 });
+                else
+                    emit({ 0x0F, cond });
+
+                const std::size_t at = code.size();
+                emit32(0);
+                return at;
+            }
+
+            void patch(std::size_t at, std::size_t target)
+            {
+                const std::int32_t rel = static_cast<std::int32_t>(target) - static_cast<std::int32_t>(at + 4);
+                std::memcpy(&code[at], &rel, sizeof(rel));
+            }
+
+            inline std::size_t here() const { return code.size(); }
+
+            inline const std::vector<std::uint8_t>& get_code() const { return code; }
+
+        private:
+
+            std::vector<std::uint8_t> code;
+    };
+
+    class ExecutableCode
+    {
+        public:
+
+            explicit ExecutableCode(const std::vector<std::uint8_t>& code)
+                : size(code.size())
+            {
+                memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+                if (memory == MAP_FAILED)
+                {
+                    memory = nullptr;
+                    return;
+                }
+
+                std::memcpy(memory, code.data(), size);
+
+                if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0)
+                {
+                    munmap(memory, size);
+                    memory = nullptr;
+                }
+            }
+
+            ExecutableCode(const ExecutableCode&) = delete;
+            ExecutableCode& operator=(const ExecutableCode&) = delete;
+
+            ~ExecutableCode() { if (memory) munmap(memory, size); }
+
+            inline NativeLoop get() const { return reinterpret_cast<NativeLoop>(memory); }
+
+        private:
+
+            void* memory;
+            std::size_t size;
+    };
+
+    struct Operand
+    {
+        bool is_slot=false;
+        std::int32_t value=0;
+    };
+
+    struct ResumeFrame
+    {
+        const gvl::Program::StmtContainer* body;
+        std::size_t index;
+    };
+
+    struct ResumePoint
+    {
+        std::vector<ResumeFrame> frames;    // outermost (the loop body) first
+        std::size_t live_locals;
+    };
+
+    // values the interpreter would print back exactly as std::to_string() does
+    bool parse_canonical_int(gvl::TokenSv sv, std::int32_t& value)
+    {
+        if (sv.empty() || (sv.size() > 1 && sv.front() == '0'))
+            return false;
+
+        const auto [ ptr, ec ] = std::from_chars(sv.data(), sv.data() + sv.size(), value);
+        return ec == std::errc() && ptr == sv.data() + sv.size() && value >= 0;
+    }
+
+    class LoopCompiler
+    {
+        public:
+
+            LoopCompiler(const gvl::Interpreter& scope, const gvl::Interpreter::VarLikeMap& vars, bool metered)
+                : scope(scope), variables(vars), metered(metered)
+            {}
+
+            bool compile(const gvl::Statement& loop)
+            {
+                // prologue: keep arrays/lengths/fuel out of rsi/rdx/rcx, idiv clobbers edx and operands use ecx
+                as.emit({ 0x49, 0x89, 0xF0 });      // mov r8, rsi
+                as.emit({ 0x49, 0x89, 0xD1 });      // mov r9, rdx
+                as.emit({ 0x49, 0x89, 0xCA });      // mov r10, rcx
+
+                const std::size_t top = as.here();
+                std::size_t exit_jump = 0;
+
+                if (!compile_condition(loop.expression, exit_jump))
+                    return false;
+
+                if (!compile_statements(loop.main_body, true))
+                    return false;
+
+                as.patch(as.emit_jump(ALWAYS), top);
+                as.patch(exit_jump, as.here());
+
+                as.emit({ 0x31, 0xC0 });            // xor eax, eax
+                as.emit({ 0xC3 });                  // ret
+
+                for (const auto& [ at, resume_id ] : deopt_jumps)
+                {
+                    as.patch(at, as.here());
+                    as.emit({ 0xB8 });              // mov eax, resume_id + 1
+                    as.emit32(resume_id + 1);
+                    as.emit({ 0xC3 });              // ret
+                }
+
+                return true;
+            }
+
+            inline const std::vector<std::uint8_t>& get_code() const { return as.get_code(); }
+
+        public:
+
+            std::vector<gvl::TokenSv> slot_names;
+            std::vector<std::int32_t> slot_values;
+            std::vector<bool> slot_written;
+            std::vector<std::size_t> locals;            // slot of every loop local, in initialization order
+            std::vector<std::vector<std::int32_t>> arrays;
+            std::vector<ResumePoint> resume_points;
+            std::vector<bool> out_of_fuel;              // per resume point, whether the fuel ran out there
+
+        private:
+
+            std::int32_t slot_disp(std::int32_t slot) const { return slot * static_cast<std::int32_t>(sizeof(std::int32_t)); }
+
+            std::int32_t add_slot(gvl::TokenSv name, std::int32_t value)
+            {
+                const std::int32_t slot = static_cast<std::int32_t>(slot_names.size());
+                slot_names.push_back(name);
+                slot_values.push_back(value);
+                slot_written.push_back(false);
+                slot_of[name] = slot;
+                return slot;
+            }
+
+            bool resolve_slot(gvl::TokenSv name, std::int32_t& slot)
+            {
+                if (const auto it = slot_of.find(name); it != slot_of.end())
+                {
+                    slot = it->second;
+                    return true;
+                }
+
+                const auto it = variables.find(name);
+                std::int32_t value = 0;
+
+                if (it == variables.end() || !parse_canonical_int(it->second.value, value))
+                    return false;
+
+                slot = add_slot(name, value);
+                return true;
+            }
+
+            bool resolve_operand(gvl::TokenSv token, Operand& operand)
+            {
+                token = scope.bound(token);
+
+                if (slot_of.contains(token) || variables.contains(token))
+                {
+                    operand.is_slot = true;
+                    return resolve_slot(token, operand.value);
+                }
+
+                operand.is_slot = false;
+                return parse_canonical_int(token, operand.value);
+            }
+
+            bool resolve_array(gvl::TokenSv name, std::int32_t& index)
+            {
+                name = scope.bound(name);
+
+                if (const auto it = array_of.find(name); it != array_of.end())
+                {
+                    index = it->second;
+                    return true;
+                }
+
+                const auto it = variables.find(name);
+
+                if (it == variables.end())
+                    return false;
+
+                std::vector<std::int32_t> values;
+
+                for (const gvl::Token& element : it->second.array_elements)
+                {
+                    std::int32_t value = 0;
+                    if (!parse_canonical_int(element, value))
+                        return false;
+                    values.push_back(value);
+                }
+
+                index = static_cast<std::int32_t>(arrays.size());
+                arrays.push_back(std::move(values));
+                array_of[name] = index;
+                return true;
+            }
+
+            std::int32_t add_resume_point(bool fuel=false)
+            {
+                resume_points.push_back(ResumePoint{ frames, locals.size() });
+                out_of_fuel.push_back(fuel);
+                return static_cast<std::int32_t>(resume_points.size() - 1);
+            }
+
+            void emit_deopt(Condition cond, std::int32_t resume_id)
+            {
+                deopt_jumps.emplace_back(as.emit_jump(cond), resume_id);
+            }
+
+            void emit_load(bool into_ecx, const Operand& operand)
+            {
+                if (operand.is_slot)
+                {
+                    as.emit({ 0x8B, static_cast<std::uint8_t>(into_ecx ? 0x8F : 0x87) });   // mov e[ac]x, [rdi + disp32]
+                    as.emit32(slot_disp(operand.value));
+                }
+                else
+                {
+                    as.emit({ static_cast<std::uint8_t>(into_ecx ? 0xB9 : 0xB8) });        // mov e[ac]x, imm32
+                    as.emit32(operand.value);
+                }
+            }
+
+            void emit_store(std::int32_t slot)
+            {
+                as.emit({ 0x89, 0x87 });            // mov [rdi + disp32], eax
+                as.emit32(slot_disp(slot));
+                slot_written[slot] = true;
+            }
+
+            // leaves the value of the right side of an assignment in eax
+            bool compile_expression(const gvl::Expression& expression, std::int32_t resume_id)
+            {
+                using namespace std::string_view_literals;
+
+                if (expression.left == "$array_at"sv)
+                {
+                    std::int32_t array = 0;
+                    Operand index;
+
+                    if (!resolve_array(expression.middle, array) || !resolve_operand(expression.right, index))
+                        return false;
+
+                    emit_load(true, index);
+                    as.emit({ 0x48, 0x63, 0xC9 });          // movsxd rcx, ecx
+                    as.emit({ 0x49, 0x3B, 0x89 });          // cmp rcx, [r9 + disp32]
+                    as.emit32(array * 8);
+                    emit_deopt(JAE, resume_id);
+                    as.emit({ 0x49, 0x8B, 0x80 });          // mov rax, [r8 + disp32]
+                    as.emit32(array * 8);
+                    as.emit({ 0x8B, 0x04, 0x88 });          // mov eax, [rax + rcx * 4]
+                    return true;
+                }
+                else if (expression.left == "$array_len"sv)
+                {
+                    std::int32_t array = 0;
+
+                    if (!resolve_array(expression.middle, array))
+                        return false;
+
+                    emit_load(false, Operand{ false, static_cast<std::int32_t>(arrays[array].size()) });
+                    return true;
+                }
+
+                Operand left, right;
+
+                if (!resolve_operand(expression.left, left))
+                    return false;
+
+                if (expression.right.empty())
+                {
+                    emit_load(false, left);
+                    return expression.middle.empty();
+                }
+
+                if (!resolve_operand(expression.right, right))
+                    return false;
+
+                emit_load(false, left);
+                emit_load(true, right);
+
+                if (expression.middle == "+"sv)
+                    as.emit({ 0x01, 0xC8 });                // add eax, ecx
+                else if (expression.middle == "-"sv)
+                    as.emit({ 0x29, 0xC8 });                // sub eax, ecx
+                else if (expression.middle == "*"sv)
+                    as.emit({ 0x0F, 0xAF, 0xC1 });          // imul eax, ecx
+                else if (expression.middle == "/"sv || expression.middle == "%"sv)
+                {
+                    as.emit({ 0x85, 0xC9 });                // test ecx, ecx
+                    emit_deopt(JE, resume_id);
+                    as.emit({ 0x99 });                      // cdq
+                    as.emit({ 0xF7, 0xF9 });                // idiv ecx
+                    if (expression.middle == "%"sv)
+                        as.emit({ 0x89, 0xD0 });            // mov eax, edx
+                    return true;
+                }
+                else
+                    return false;
+
+                // the interpreter types negative values as strings, let it take over from here
+                as.emit({ 0x85, 0xC0 });                    // test eax, eax
+                emit_deopt(JS, resume_id);
+                return true;
+            }
+
+            // emits the jump taken when the condition is false and returns its patch position
+            bool compile_condition(const gvl::Expression& expression, std::size_t& false_jump)
+            {
+                using namespace std::string_view_literals;
+
+                Operand left, right;
+
+                if (!resolve_operand(expression.left, left) || !resolve_operand(expression.right, right))
+                    return false;
+
+                const Condition negated =
+                    expression.middle == "<"sv ? JGE :
+                    expression.middle == "<="sv ? JG :
+                    expression.middle == ">"sv ? JLE :
+                    expression.middle == ">="sv ? JL :
+                    expression.middle == "=="sv ? JNE : ALWAYS;
+
+                if (negated == ALWAYS)
+                    return false;
+
+                emit_load(false, left);
+                emit_load(true, right);
+                as.emit({ 0x39, 0xC8 });                    // cmp eax, ecx
+                false_jump = as.emit_jump(negated);
+                return true;
+            }
+
+            bool compile_statement(const gvl::Statement& stmt, std::size_t idx)
+            {
+                using gvl::StatementType;
+
+                if (stmt.type == StatementType::ASSIGN)
+                {
+                    const gvl::TokenSv name = scope.bound(stmt.line.front());
+                    const auto it = variables.find(name);
+                    std::int32_t slot = 0;
+
+                    if (!slot_of.contains(name) && (it == variables.end() || it->second.is_const))
+                        return false;
+
+                    if (!resolve_slot(name, slot) || !compile_expression(stmt.expression, add_resume_point()))
+                        return false;
+
+                    emit_store(slot);
+                    return true;
+                }
+                else if (stmt.type == StatementType::INIT)
+                {
+                    const gvl::TokenSv name = scope.bound(stmt.line[1]);
+
+                    // an existing variable makes 'var' a no-op, locals only live in the loop body itself
+                    if (variables.contains(name) || slot_of.contains(name))
+                        return true;
+
+                    if (frames.size() != 1 || !compile_expression(stmt.expression, add_resume_point()))
+                        return false;
+
+                    const std::int32_t slot = add_slot(name, 0);
+                    locals.push_back(slot);
+                    emit_store(slot);
+                    return true;
+                }
+                else if (stmt.type == StatementType::IF)
+                {
+                    std::size_t false_jump = 0;
+
+                    if (!compile_condition(stmt.expression, false_jump))
+                        return false;
+
+                    frames.back().index = idx + 1;
+
+                    if (!compile_statements(stmt.main_body))
+                        return false;
+
+                    as.patch(false_jump, as.here());
+                    return true;
+                }
+                else if (stmt.type == StatementType::WHILE)
+                {
+                    const std::size_t top = as.here();
+                    std::size_t false_jump = 0;
+
+                    if (!compile_condition(stmt.expression, false_jump))
+                        return false;
+
+                    frames.back().index = idx;
+
+                    if (!compile_statements(stmt.main_body, true))
+                        return false;
+
+                    as.patch(as.emit_jump(ALWAYS), top);
+                    as.patch(false_jump, as.here());
+                    return true;
+                }
+
+                return false;
+            }
+
+            bool compile_statements(const gvl::Program::StmtContainer& body, bool loop_body=false)
+            {
+                frames.push_back(ResumeFrame{ &body, 0 });
+
+                // the interpreter runs the iteration the fuel runs out in, and checks the budget
+                if (metered && loop_body)
+                {
+                    as.emit({ 0x49, 0x81, 0x2A });      // sub qword [r10], imm32
+                    as.emit32(static_cast<std::int32_t>(std::max<std::size_t>(body.size(), 1)));
+                    emit_deopt(JS, add_resume_point(true));
+                }
+
+                for (std::size_t idx = 0; idx < body.size(); ++idx)
+                {
+                    frames.back().index = idx;
+
+                    if (!compile_statement(body[idx], idx))
+                        return false;
+                }
+
+                frames.pop_back();
+                return true;
+            }
+
+        private:
+
+            const gvl::Interpreter& scope;            // the loop's, which binds the names of a function body
+            const gvl::Interpreter::VarLikeMap& variables;
+            const bool metered;
+            std::unordered_map<gvl::TokenSv, std::int32_t> slot_of;
+            std::unordered_map<gvl::TokenSv, std::int32_t> array_of;
+            std::vector<ResumeFrame> frames;
+            std::vector<std::pair<std::size_t, std::int32_t>> deopt_jumps;
+            Assembler as;
+    };
+}
+
+gvl::Jit::Outcome gvl::Jit::execute_loop(Interpreter& interpreter, const Statement& loop)
+{
+    const bool metered = Budget::is_enabled();
+    LoopCompiler compiler(interpreter, Interpreter::variables, metered);
+
+    if (!compiler.compile(loop))
+        return Outcome::NOT_COMPILED;
+
+    const ExecutableCode code(compiler.get_code());
+
+    if (!code.get())
+        return Outcome::NOT_COMPILED;
+
+    std::vector<std::int32_t> slots(compiler.slot_values);
+    std::vector<const std::int32_t*> arrays;
+    std::vector<std::int64_t> lengths;
+
+    for (const auto& array : compiler.arrays)
+    {
+        arrays.push_back(array.data());
+        lengths.push_back(static_cast<std::int64_t>(array.size()));
+    }
+
+    const std::int64_t given = metered ? static_cast<std::int64_t>(Budget::fuel()) : 0;
+    std::int64_t fuel = given;
+    const std::int32_t status = code.get()(slots.data(), arrays.data(), lengths.data(), &fuel);
+
+    std::vector<bool> is_local(slots.size(), false);
+    for (std::size_t slot : compiler.locals)
+        is_local[slot] = true;
+
+    for (std::size_t slot = 0; slot < slots.size(); ++slot)
+    {
+        if (compiler.slot_written[slot] && !is_local[slot])
+            Interpreter::variables.at(compiler.slot_names[slot]).value = std::to_string(slots[slot]);
+    }
+
+    if (metered)
+        Budget::count(given - std::max<std::int64_t>(fuel, 0));
+
+    if (status == 0)
+        return Outcome::FINISHED;
+
+    // finish the interrupted iteration statement by statement, innermost block first
+    const ResumePoint& point = compiler.resume_points[status - 1];
+    std::vector<TokenSv> materialized;
+
+    for (std::size_t i = 0; i < point.live_locals; ++i)
+    {
+        const std::size_t slot = compiler.locals[i];
+
+        VarLike varlike;
+        varlike.name = compiler.slot_names[slot];
+        varlike.value = std::to_string(slots[slot]);
+        varlike.type = VarLikeType::INT;
+
+        Interpreter::variables[varlike.name] = varlike;
+        materialized.push_back(varlike.name);
+    }
+
+    for (auto it = point.frames.rbegin(); it != point.frames.rend(); ++it)
+    {
+        const Program::StmtContainer rest(it->body->begin() + it->index, it->body->end());
+        Interpreter::execute_body(interpreter, rest);
+    }
+
+    Interpreter::clear_scope(interpreter, materialized);
+
+    return compiler.out_of_fuel[status - 1] ? Outcome::OUT_OF_FUEL : Outcome::DEOPTIMIZED;
+}
+
+#else
+
+gvl::Jit::Outcome gvl::Jit::execute_loop(Interpreter&, const Statement&)
+{
+    return Outcome::NOT_COMPILED;
+}
+
+#endif
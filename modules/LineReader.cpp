@@ -0,0 +1,82 @@
+#include "../includes/LineReader.hpp"
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+
+gvl::LineReader::LineReader(std::istream& in, std::size_t chunk_size)
+    : in(&in), buffer(std::max<std::size_t>(chunk_size, 1))
+{}
+
+gvl::LineReader::LineReader(const std::string& file_name, std::size_t chunk_size)
+    : file(std::make_unique<std::ifstream>(file_name, std::ios::binary)), in(file.get()), buffer(std::max<std::size_t>(chunk_size, 1))
+{
+    if (!*this->file)
+        throw std::runtime_error("can not open '" + file_name + "'");
+}
+
+// keeps the unfinished line and appends what the stream has ready after it, waiting only while it has nothing
+bool gvl::LineReader::fill()
+{
+    if (this->eof)
+        return false;
+
+    const std::size_t pending = this->end - this->begin;
+
+    // the unfinished line moves to the front only once the chunk is full, small reads would move it again and again
+    if (pending == 0 || this->end == this->buffer.size())
+    {
+        if (pending == this->buffer.size())
+            this->buffer.resize(2 * this->buffer.size());
+        else if (pending > 0)
+            std::memmove(this->buffer.data(), this->buffer.data() + this->begin, pending);
+
+        this->begin = 0;
+        this->end = pending;
+    }
+
+    std::streambuf* source = this->in->rdbuf();
+    std::streamsize ready = source->in_avail();
+
+    if (ready == 0)
+    {
+        // what was printed so far is seen before waiting for input, as reading through the stream would do
+        if (this->in->tie() != nullptr)
+            this->in->tie()->flush();
+
+        ready = source->sgetc() == std::char_traits<char>::eof() ? 0 : std::max<std::streamsize>(source->in_avail(), 1);
+    }
+
+    const std::streamsize wanted = std::min<std::streamsize>(std::max<std::streamsize>(ready, 0), this->buffer.size() - this->end);
+    const std::size_t read = wanted > 0 ? static_cast<std::size_t>(source->sgetn(this->buffer.data() + this->end, wanted)) : 0;
+
+    this->end += read;
+    this->eof = read == 0;
+
+    return read > 0;
+}
+
+bool gvl::LineReader::next(std::string_view& line)
+{
+    for (;;)
+    {
+        const char* first = this->buffer.data() + this->begin;
+        const char* newline = static_cast<const char*>(std::memchr(first + this->scanned, '\n', this->end - this->begin - this->scanned));
+
+        if (newline != nullptr || (this->eof && this->begin < this->end))
+        {
+            const std::size_t len = newline != nullptr ? newline - first : this->end - this->begin;
+
+            line = std::string_view(first, len > 0 && first[len - 1] == '\r' ? len - 1 : len);
+            this->begin += newline != nullptr ? len + 1 : len;
+            this->scanned = 0;
+
+            return true;
+        }
+
+        this->scanned = this->end - this->begin;
+
+        if (!fill() && this->begin == this->end)
+            return false;
+    }
+}
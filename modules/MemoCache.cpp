@@ -0,0 +1,73 @@
+#include "../includes/MemoCache.hpp"
+
+
+std::size_t gvl::MemoCache::default_capacity = 1024;
+
+
+gvl::MemoCache::MemoCache(std::size_t capacity)
+    : capacity(capacity)
+{}
+
+bool gvl::MemoCache::lookup(const Token& key, std::vector<Token>& results)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    const auto it = this->index.find(key);
+
+    if (it == this->index.end())
+    {
+        ++this->misses;
+        return false;
+    }
+
+    ++this->hits;
+    this->entries.splice(this->entries.begin(), this->entries, it->second);
+    results = it->second->results;
+
+    return true;
+}
+
+void gvl::MemoCache::store(const Token& key, const std::vector<Token>& results)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (this->capacity == 0)
+        return;
+
+    const auto it = this->index.find(key);
+
+    if (it != this->index.end())
+    {
+        it->second->results = results;
+        this->entries.splice(this->entries.begin(), this->entries, it->second);
+        return;
+    }
+
+    if (this->entries.size() == this->capacity)
+    {
+        this->index.erase(this->entries.back().key);
+        this->entries.pop_back();
+    }
+
+    this->entries.push_front(Entry{ key, results });
+    this->index.emplace(this->entries.front().key, this->entries.begin());
+}
+
+std::size_t gvl::MemoCache::get_hits() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->hits;
+}
+
+std::size_t gvl::MemoCache::get_misses() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->misses;
+}
+
+void gvl::MemoCache::clear()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->index.clear();
+    this->entries.clear();
+}
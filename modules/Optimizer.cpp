@@ -0,0 +1,633 @@
+#include "../includes/Optimizer.hpp"
+#include "../includes/Parser.hpp"
+#include "../includes/Interpreter.hpp"
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+
+std::atomic<bool> gvl::Optimizer::enabled = true;
+std::atomic<bool> gvl::Optimizer::reporting = false;
+std::atomic<std::size_t> gvl::Optimizer::inline_size = 8;
+
+namespace
+{
+    // one optimize() call, which numbers the hidden variables and the inlined calls of its program; programs
+    // may be optimized on several threads at once
+    struct Pass
+    {
+        std::size_t temps_no=0;
+        std::size_t inlined_no=0;
+        std::size_t inline_size;
+        bool reporting;
+    };
+
+    // names a statement may write, all of them when it runs code that is not visible here
+    struct Writes
+    {
+        std::set<gvl::Token> names;
+        bool all=false;
+    };
+
+    // a function whose calls are replaced by its body
+    struct Inlinable
+    {
+        gvl::Statement function;
+        std::set<gvl::Token> outer_names;   // names its body uses besides its parameters and locals
+        bool has_locals;
+    };
+
+    // functions by name and the names some reached code calls
+    struct CallGraph
+    {
+        std::multimap<gvl::Token, gvl::Statement*> functions;
+        std::set<gvl::Token> called;
+        std::set<const gvl::Statement*> reached;
+    };
+}
+
+
+static void collect_writes(const gvl::Statement& stmt, Writes& writes)
+{
+    using gvl::StatementType;
+
+    switch (stmt.type)
+    {
+        case StatementType::INIT:
+        case StatementType::CONST:
+        case StatementType::ARRAY_INIT:
+            writes.names.insert(stmt.line[1]);
+            if (stmt.expression.left == "$array_pop")
+                writes.names.insert(stmt.expression.middle);
+            break;
+        case StatementType::DICT_INIT:
+        case StatementType::ARRAY_APPEND:
+        case StatementType::ARRAY_SET:
+        case StatementType::ARRAY_POP:
+        case StatementType::ARRAY_SORT:
+        case StatementType::DICT_SET:
+        case StatementType::DICT_REMOVE:
+            writes.names.insert(stmt.line[1]);
+            break;
+        case StatementType::ASSIGN:
+            writes.names.insert(stmt.line.front());
+            if (stmt.expression.left == "$array_pop")
+                writes.names.insert(stmt.expression.middle);
+            break;
+        case StatementType::READCHAR:
+        case StatementType::READINT:
+        case StatementType::READFLOAT:
+        case StatementType::READSTR:
+        case StatementType::READLN:
+        case StatementType::CHANNEL_RECV:
+        case StatementType::CHANNEL_INIT:
+        case StatementType::FOR_LINES:
+            writes.names.insert(stmt.expression.left);
+            writes.names.insert(stmt.expression.middle);
+            writes.names.insert(stmt.expression.right);
+            break;
+        case StatementType::PFOR:
+            writes.names.insert(stmt.expression.left);
+            for (const auto& reduction : gvl::Parser::get_pfor_reductions(stmt.line))
+                writes.names.insert(reduction.second);
+            break;
+        case StatementType::CALL_FUNC:
+        case StatementType::SPAWN:
+        case StatementType::AWAIT:
+        case StatementType::DEF_FUNC:
+        case StatementType::FOR_GENERATOR:
+        case StatementType::YIELD:      // the consumer runs until the generator goes on
+            writes.all = true;
+            break;
+        default:
+            break;
+    }
+
+    for (const gvl::Statement& sub_stmt : stmt.main_body)
+        collect_writes(sub_stmt, writes);
+    for (const gvl::Statement& sub_stmt : stmt.second_body)
+        collect_writes(sub_stmt, writes);
+}
+
+static bool is_literal(const gvl::Token& token)
+{
+    return token.empty() || token.front() == '\'' || token.front() == '"' || token == "true" || token == "false" ||
+        std::all_of(token.begin(), token.end(), [](unsigned char c) { return std::isdigit(c) || c == '.'; });
+}
+
+// locals is null outside of functions, inside them parameters and outer variables may name the same variable
+static bool is_written(const Writes& writes, const gvl::Token& name, const std::set<gvl::Token>* locals)
+{
+    if (is_literal(name))
+        return false;
+
+    if (writes.all || writes.names.contains(name))
+        return true;
+
+    if (locals == nullptr || locals->contains(name))
+        return false;
+
+    return std::any_of(writes.names.begin(), writes.names.end(), [locals](const gvl::Token& written)
+        { return !written.empty() && !locals->contains(written); });
+}
+
+// variable = <expression> statements whose value only depends on the operands, which are appended;
+// $array_at, $dict_get and $array_pop may hand out or change a shared array, they are left alone
+static bool is_candidate(const gvl::Statement& stmt, std::vector<gvl::Token>& operands)
+{
+    using gvl::StatementType;
+
+    if (stmt.type != StatementType::INIT && stmt.type != StatementType::CONST && stmt.type != StatementType::ASSIGN)
+        return false;
+
+    const gvl::Expression& expression = stmt.expression;
+
+    if (expression.left == "$array_len" || expression.left == "$dict_len" || expression.left == "$dict_has" ||
+        expression.left == "$array_bsearch" || expression.left == "$str_len" || expression.left == "$str_find" ||
+        expression.left == "$str_count")
+    {
+        operands.push_back(expression.middle);
+        operands.push_back(expression.right);
+        return true;
+    }
+
+    // the replacement of $str_replace is not part of the expression, so two replaces would look alike
+    if (expression.left == "$array_at" || expression.left == "$dict_get" || expression.left == "$array_pop" ||
+        expression.left == "$str_replace")
+        return false;
+
+    // a copy is as cheap as the hidden variable would be
+    if (expression.middle.empty())
+        return false;
+
+    operands.push_back(expression.left);
+    operands.push_back(expression.right);
+    return true;
+}
+
+static gvl::Token expression_key(const gvl::Expression& expression)
+{
+    gvl::Token key = expression.left;
+
+    for (const gvl::Token* token : { &expression.middle, &expression.right })
+    {
+        if (!token->empty())
+            key += ' ' + *token;
+    }
+
+    return key;
+}
+
+// a RETURN may end an iteration before the statements after it run
+static bool may_return(const gvl::Statement& stmt)
+{
+    if (stmt.type == gvl::StatementType::RETURN)
+        return true;
+
+    return std::any_of(stmt.main_body.begin(), stmt.main_body.end(), may_return);
+}
+
+static gvl::Token new_temp(Pass& pass)
+{
+    return ".t" + std::to_string(++pass.temps_no);
+}
+
+// var temp = <stmt's expression>
+static gvl::Statement make_temp(const gvl::Statement& stmt, const gvl::Token& temp)
+{
+    gvl::Statement init;
+    init.type = gvl::StatementType::INIT;
+    init.line = { "var", temp, "=" };
+    init.expression = stmt.expression;
+    init.line_no = stmt.line_no;
+
+    for (const gvl::Token* token : { &stmt.expression.left, &stmt.expression.middle, &stmt.expression.right })
+    {
+        if (!token->empty())
+            init.line.push_back(*token);
+    }
+
+    return init;
+}
+
+// the statement copies temp instead of computing its expression
+static void use_temp(gvl::Statement& stmt, const gvl::Token& temp)
+{
+    if (stmt.type == gvl::StatementType::ASSIGN)
+        stmt.line = { stmt.line[0], "=", temp };
+    else
+        stmt.line = { stmt.line[0], stmt.line[1], "=", temp };
+
+    stmt.expression = gvl::Expression{ temp, "", "" };
+}
+
+static void report(const Pass& pass, const gvl::Statement& stmt, const std::string& what)
+{
+    if (pass.reporting)
+        std::cerr << "opt: line " << stmt.line_no << ": " << what << "\n";
+}
+
+// moves what the body of the while loop at body[i] computes from variables the loop never writes in front of it,
+// into a block entered on the loop's own condition, so nothing is computed for a loop that does not run
+static void hoist_invariants(Pass& pass, std::vector<gvl::Statement>& body, std::size_t i, const std::set<gvl::Token>* locals)
+{
+    gvl::Statement& loop = body[i];
+    Writes writes;
+
+    for (const gvl::Statement& stmt : loop.main_body)
+        collect_writes(stmt, writes);
+
+    if (writes.all)
+        return;
+
+    std::vector<gvl::Statement> hoisted;
+    std::map<gvl::Token, gvl::Token> temps;
+
+    for (gvl::Statement& stmt : loop.main_body)
+    {
+        if (may_return(stmt))
+            break;
+
+        std::vector<gvl::Token> operands;
+
+        if (!is_candidate(stmt, operands) ||
+            std::any_of(operands.begin(), operands.end(), [&](const gvl::Token& op) { return is_written(writes, op, locals); }))
+            continue;
+
+        const gvl::Token key = expression_key(stmt.expression);
+        auto it = temps.find(key);
+
+        if (it == temps.end())
+        {
+            it = temps.emplace(key, new_temp(pass)).first;
+            hoisted.push_back(make_temp(stmt, it->second));
+        }
+
+        report(pass, stmt, "hoisted '" + key + "' out of the loop at line " + std::to_string(loop.line_no));
+        use_temp(stmt, it->second);
+    }
+
+    if (hoisted.empty())
+        return;
+
+    gvl::Statement guard;
+    guard.type = gvl::StatementType::IF;
+    guard.line = loop.line;
+    guard.line.front() = "if";
+    guard.expression = loop.expression;
+    guard.line_no = loop.line_no;
+    guard.main_body = std::move(hoisted);
+    guard.main_body.push_back(std::move(loop));
+
+    body[i] = std::move(guard);
+}
+
+// a statement computing what an earlier one of the same block computed from unchanged operands reuses its value
+static void eliminate_common(Pass& pass, std::vector<gvl::Statement>& body, const std::set<gvl::Token>* locals)
+{
+    struct Computed
+    {
+        std::size_t index;
+        std::vector<gvl::Token> operands;
+        gvl::Token temp;
+    };
+
+    std::map<gvl::Token, Computed> computed;
+
+    for (std::size_t i = 0; i < body.size(); ++i)
+    {
+        std::vector<gvl::Token> operands;
+
+        if (is_candidate(body[i], operands))
+        {
+            const gvl::Token key = expression_key(body[i].expression);
+            auto it = computed.find(key);
+
+            if (it == computed.end())
+                computed.emplace(key, Computed{ i, operands, gvl::Token() });
+            else
+            {
+                Computed& first = it->second;
+
+                if (first.temp.empty())
+                {
+                    first.temp = new_temp(pass);
+                    body.insert(body.begin() + first.index, make_temp(body[first.index], first.temp));
+                    use_temp(body[first.index + 1], first.temp);
+                    ++i;
+
+                    for (auto& [ other_key, other ] : computed)
+                    {
+                        if (other.index > first.index)
+                            ++other.index;
+                    }
+                }
+
+                report(pass, body[i], "reused '" + key + "' computed at line " + std::to_string(body[first.index].line_no));
+                use_temp(body[i], first.temp);
+            }
+        }
+
+        // collecting walks the whole statement, nested blocks would be walked once per level around them
+        if (computed.empty())
+            continue;
+
+        Writes writes;
+        collect_writes(body[i], writes);
+
+        std::erase_if(computed, [&](const auto& entry)
+        {
+            return std::any_of(entry.second.operands.begin(), entry.second.operands.end(),
+                [&](const gvl::Token& op) { return is_written(writes, op, locals); });
+        });
+    }
+}
+
+static void collect_function_locals(const std::vector<gvl::Statement>& body, std::set<gvl::Token>& locals)
+{
+    for (const gvl::Statement& stmt : body)
+    {
+        if (stmt.type == gvl::StatementType::INIT || stmt.type == gvl::StatementType::CONST ||
+            stmt.type == gvl::StatementType::ARRAY_INIT || stmt.type == gvl::StatementType::DICT_INIT)
+            locals.insert(stmt.line[1]);
+        else if (stmt.type == gvl::StatementType::PFOR || stmt.type == gvl::StatementType::FOR_LINES ||
+                 stmt.type == gvl::StatementType::FOR_GENERATOR)
+            locals.insert(stmt.expression.left);
+
+        collect_function_locals(stmt.main_body, locals);
+    }
+}
+
+static void collect_names(const std::vector<gvl::Statement>& body, std::set<gvl::Token>& names)
+{
+    for (const gvl::Statement& stmt : body)
+    {
+        names.insert(stmt.line.begin(), stmt.line.end());
+        names.insert(stmt.expression.left);
+        names.insert(stmt.expression.middle);
+        names.insert(stmt.expression.right);
+
+        collect_names(stmt.main_body, names);
+    }
+}
+
+static void count_definitions(const std::vector<gvl::Statement>& body, std::map<gvl::Token, std::size_t>& definitions)
+{
+    for (const gvl::Statement& stmt : body)
+    {
+        if (stmt.type == gvl::StatementType::DEF_FUNC)
+            ++definitions[gvl::Parser::get_function_name(stmt)];
+
+        count_definitions(stmt.main_body, definitions);
+    }
+}
+
+// statements of a body that calls nothing and can not leave its caller, 0 for other bodies
+static std::size_t leaf_size(const std::vector<gvl::Statement>& body)
+{
+    using gvl::StatementType;
+
+    std::size_t size = 0;
+
+    for (const gvl::Statement& stmt : body)
+    {
+        if (stmt.type == StatementType::CALL_FUNC || stmt.type == StatementType::SPAWN || stmt.type == StatementType::DEF_FUNC ||
+            stmt.type == StatementType::RETURN || stmt.type == StatementType::YIELD || stmt.type == StatementType::FOR_GENERATOR)
+            return 0;
+
+        const std::size_t sub_size = leaf_size(stmt.main_body);
+
+        if (sub_size == 0 && !stmt.main_body.empty())
+            return 0;
+
+        size += 1 + sub_size;
+    }
+
+    return size;
+}
+
+static std::set<gvl::Token> function_scope(const gvl::Statement& function)
+{
+    std::set<gvl::Token> scope{ function.expression.left, function.expression.middle, function.expression.right };
+    collect_function_locals(function.main_body, scope);
+    scope.erase(gvl::Token());
+
+    return scope;
+}
+
+// pure functions keep their calls, which are served from their caches
+static bool is_inlinable(const Pass& pass, const gvl::Statement& function, const std::map<gvl::Token, std::size_t>& definitions)
+{
+    const std::size_t size = leaf_size(function.main_body);
+
+    return size > 0 && size <= pass.inline_size && !gvl::Parser::is_pure_function(function) &&
+        !gvl::Parser::is_generator_function(function) &&
+        !gvl::Parser::is_noinline_function(function) && definitions.at(gvl::Parser::get_function_name(function)) == 1;
+}
+
+// appends the callee's bound body to body in place of the call
+static void inline_at(Pass& pass, std::vector<gvl::Statement>& body, const gvl::Statement& call, const Inlinable& callee)
+{
+    gvl::Statement block = gvl::Optimizer::inline_call(call, callee.function, "@i" + std::to_string(++pass.inlined_no));
+
+    if (callee.has_locals)
+    {
+        body.push_back(std::move(block));
+        return;
+    }
+
+    // without locals there is nothing to drop, the statements take the call's place
+    body.insert(body.end(), std::make_move_iterator(block.main_body.begin()), std::make_move_iterator(block.main_body.end()));
+}
+
+static void inline_calls(Pass& pass, std::vector<gvl::Statement>& body, const std::map<gvl::Token, Inlinable>& inlinable,
+    const std::set<gvl::Token>* caller_scope);
+
+// a call inside a function is only inlined when the callee uses none of the caller's own names,
+// which the caller's activations rename; appends what stmt became to inlined
+static void inline_calls(Pass& pass, gvl::Statement& stmt, std::vector<gvl::Statement>& inlined, const std::map<gvl::Token, Inlinable>& inlinable,
+    const std::set<gvl::Token>* caller_scope)
+{
+    if (stmt.type == gvl::StatementType::CALL_FUNC)
+    {
+        const auto it = inlinable.find(stmt.line[1]);
+
+        if (it == inlinable.end() || (caller_scope != nullptr && std::any_of(it->second.outer_names.begin(),
+            it->second.outer_names.end(), [caller_scope](const gvl::Token& name) { return caller_scope->contains(name); })))
+        {
+            inlined.push_back(std::move(stmt));
+            return;
+        }
+
+        report(pass, stmt, "inlined the call of " + stmt.line[1]);
+        inline_at(pass, inlined, stmt, it->second);
+        return;
+    }
+
+    if (stmt.type == gvl::StatementType::DEF_FUNC)
+    {
+        const std::set<gvl::Token> scope = function_scope(stmt);
+        inline_calls(pass, stmt.main_body, inlinable, &scope);
+    }
+    else
+        inline_calls(pass, stmt.main_body, inlinable, caller_scope);
+
+    inlined.push_back(std::move(stmt));
+}
+
+// the body is rebuilt in one pass, splicing callees into it in place would move everything behind every call
+static void inline_calls(Pass& pass, std::vector<gvl::Statement>& body, const std::map<gvl::Token, Inlinable>& inlinable,
+    const std::set<gvl::Token>* caller_scope)
+{
+    std::vector<gvl::Statement> inlined;
+    inlined.reserve(body.size());
+
+    for (gvl::Statement& stmt : body)
+        inline_calls(pass, stmt, inlined, inlinable, caller_scope);
+
+    body = std::move(inlined);
+}
+
+// functions are known from their definition on, so only calls in top level statements after
+// the one definition of a function are inlined
+static void inline_functions(Pass& pass, std::vector<gvl::Statement>& statements)
+{
+    std::map<gvl::Token, std::size_t> definitions;
+    std::map<gvl::Token, Inlinable> inlinable;
+    std::vector<gvl::Statement> inlined;
+
+    count_definitions(statements, definitions);
+    inlined.reserve(statements.size());
+
+    for (gvl::Statement& next : statements)
+    {
+        const bool is_definition = next.type == gvl::StatementType::DEF_FUNC;
+        inline_calls(pass, next, inlined, inlinable, nullptr);
+
+        const gvl::Statement& stmt = inlined.back();
+
+        if (!is_definition || !is_inlinable(pass, stmt, definitions))
+            continue;
+
+        Inlinable function{ stmt, {}, false };
+        std::set<gvl::Token> locals;
+
+        collect_function_locals(stmt.main_body, locals);
+        function.has_locals = !locals.empty();
+
+        collect_names(stmt.main_body, function.outer_names);
+        for (const gvl::Token& name : function_scope(stmt))
+            function.outer_names.erase(name);
+
+        inlinable.emplace(gvl::Parser::get_function_name(stmt), std::move(function));
+    }
+
+    statements = std::move(inlined);
+}
+
+gvl::Statement gvl::Optimizer::inline_call(const Statement& call, const Statement& function, const Token& suffix)
+{
+    Statement bound(function);
+    Interpreter::bind_frame(bound, { call.expression.left, call.expression.middle, call.expression.right }, suffix);
+
+    // a block that always runs, whose locals are gone when it ends like those of the call were
+    Statement block;
+    block.type = StatementType::IF;
+    block.line = { "if", "1", "==", "1", "{" };
+    block.expression = Expression{ "1", "==", "1" };
+    block.main_body = std::move(bound.main_body);
+    block.line_no = call.line_no;
+
+    return block;
+}
+
+// hidden variables live in blocks only, where they are dropped with the block's other variables
+static void optimize_body(Pass& pass, std::vector<gvl::Statement>& body, bool in_block, const std::set<gvl::Token>* locals)
+{
+    for (std::size_t i = 0; i < body.size(); ++i)
+    {
+        if (body[i].type == gvl::StatementType::DEF_FUNC)
+        {
+            std::set<gvl::Token> function_locals;
+            collect_function_locals(body[i].main_body, function_locals);
+
+            optimize_body(pass, body[i].main_body, true, &function_locals);
+        }
+        else
+            optimize_body(pass, body[i].main_body, true, locals);
+
+        if (body[i].type == gvl::StatementType::WHILE)
+            hoist_invariants(pass, body, i, locals);
+    }
+
+    if (in_block)
+        eliminate_common(pass, body, locals);
+}
+
+static void reach_calls(std::vector<gvl::Statement>& body, CallGraph& graph);
+
+static void reach_function(gvl::Statement& function, CallGraph& graph)
+{
+    if (!graph.reached.insert(&function).second)
+        return;
+
+    gvl::Parser::parse_function_body(function);
+    reach_calls(function.main_body, graph);
+}
+
+// calls name their functions literally, so every function that may run is reached from the top-level statements
+// through the calls of the bodies reached before; only their bodies are parsed, the others keep waiting for a call
+static void reach_calls(std::vector<gvl::Statement>& body, CallGraph& graph)
+{
+    using gvl::StatementType;
+
+    for (gvl::Statement& stmt : body)
+    {
+        if (stmt.type == StatementType::DEF_FUNC)
+        {
+            const gvl::Token& name = gvl::Parser::get_function_name(stmt);
+
+            graph.functions.emplace(name, &stmt);
+            if (graph.called.contains(name))
+                reach_function(stmt, graph);
+
+            continue;
+        }
+
+        const gvl::Token* callee = stmt.type == StatementType::CALL_FUNC ? &stmt.line[1] :
+            stmt.type == StatementType::SPAWN || stmt.type == StatementType::FOR_GENERATOR ? &stmt.expression.middle : nullptr;
+
+        if (callee != nullptr && graph.called.insert(*callee).second)
+        {
+            const auto [ first, last ] = graph.functions.equal_range(*callee);
+
+            for (auto it = first; it != last; ++it)
+                reach_function(*it->second, graph);
+        }
+
+        reach_calls(stmt.main_body, graph);
+    }
+}
+
+void gvl::Optimizer::optimize(Program& program)
+{
+    if (!enabled)
+        return;
+
+    Pass pass;
+    pass.inline_size = inline_size;
+    pass.reporting = reporting;
+
+    CallGraph graph;
+    reach_calls(program.statements, graph);
+
+    if (pass.inline_size > 0)
+        inline_functions(pass, program.statements);
+
+    optimize_body(pass, program.statements, false, nullptr);
+}
@@ -1,4 +1,5 @@
 #include "../includes/Parser.hpp"
+#include "../includes/ThreadPool.hpp"
 #include <string>
 #include <vector>
 #include <array>
@@ -8,9 +9,18 @@
 #include <cassert>
 #include <iostream>
 #include <string_view>
+#include <set>
+#include <cctype>
+#include <exception>
 
 
-std::size_t gvl::Parser::line_no = 1;
+thread_local std::size_t gvl::Parser::line_no = 1;
+
+// scripts shorter than two pieces of this many lines are parsed on the calling thread
+static constexpr std::size_t parallel_lines = 1 << 12;
+
+// a block that is never closed, or whose header does not end with its bracket
+static constexpr std::size_t no_closer = static_cast<std::size_t>(-1);
 
 
 static bool valid_stmt_tokens_no(std::uint32_t low, std::uint32_t high, std::uint32_t sz)
@@ -65,7 +75,7 @@ static std::vector<std::string> split_string_into_vector(const std::string& str)
 
 static gvl::StatementType set_statement_type(const std::vector<gvl::Token>& tokens)
 {
-    if (tokens.size() == 1)
+    if (tokens.size() == 1 && tokens.front() != "return" && tokens.front() != "checkpoint")
         throw gvl::Parser::ParseTimeError{ "invalid statement type", gvl::Parser::get_line_no() };
 
     using gvl::StatementType;
@@ -76,6 +86,8 @@ static gvl::StatementType set_statement_type(const std::vector<gvl::Token>& toke
     tokens.front() == "$array_append" ? StatementType::ARRAY_APPEND :
     tokens.front() == "$array_set" ? StatementType::ARRAY_SET :
     tokens.front() == "$array_pop" ? StatementType::ARRAY_POP :
+    tokens.front() == "$array_save" ? StatementType::ARRAY_SAVE :
+    tokens.front() == "$array_sort" ? StatementType::ARRAY_SORT :
     tokens.front() == "const" ? StatementType::CONST :
     tokens.front() == "print" ? StatementType::PRINT :
     tokens.front() == "println" ? StatementType::PRINTLN :
@@ -87,10 +99,24 @@ static gvl::StatementType set_statement_type(const std::vector<gvl::Token>& toke
     tokens.front() == "if" ? StatementType::IF :
     tokens.front() == "else" ? StatementType::ELSE :
     tokens.front() == "while" ? StatementType::WHILE :
+    tokens.front() == "pfor" ? StatementType::PFOR :
+    tokens.front() == "for" ? (tokens.size() > 3 && tokens[3] == "call" ? StatementType::FOR_GENERATOR : StatementType::FOR_LINES) :
     tokens.front() == "}" ? StatementType::BRACKET :
-    tokens.front() == "function" ? StatementType::DEF_FUNC :
+    tokens.front() == "function" || tokens.front() == "pure" || tokens.front() == "noinline" ||
+    tokens.front() == "generator" ? StatementType::DEF_FUNC :
+    tokens.front() == "yield" ? StatementType::YIELD :
     tokens.front() == "call" ? StatementType::CALL_FUNC :
     tokens.front() == "return" ? StatementType::RETURN :
+    tokens.front() == "checkpoint" ? StatementType::CHECKPOINT :
+    tokens.front() == "spawn" ? StatementType::SPAWN :
+    tokens.front() == "await" ? StatementType::AWAIT :
+    tokens.front() == "channel" ? StatementType::CHANNEL_INIT :
+    tokens.front() == "send" ? StatementType::CHANNEL_SEND :
+    tokens.front() == "recv" ? StatementType::CHANNEL_RECV :
+    tokens.front() == "close" ? StatementType::CHANNEL_CLOSE :
+    tokens.front() == "dict" ? StatementType::DICT_INIT :
+    tokens.front() == "$dict_set" ? StatementType::DICT_SET :
+    tokens.front() == "$dict_remove" ? StatementType::DICT_REMOVE :
     tokens[1] == "=" ? StatementType::ASSIGN : StatementType::NONE;
 
     if (type == StatementType::NONE)
@@ -104,7 +130,9 @@ static bool statement_is_block(gvl::StatementType type)
 {
     return 
         type == gvl::StatementType::IF || type == gvl::StatementType::ELSE || 
-        type == gvl::StatementType::WHILE || type == gvl::StatementType::DEF_FUNC;
+        type == gvl::StatementType::WHILE || type == gvl::StatementType::DEF_FUNC ||
+        type == gvl::StatementType::PFOR || type == gvl::StatementType::FOR_LINES ||
+        type == gvl::StatementType::FOR_GENERATOR;
 }
 
 static gvl::Expression set_statement_expression(gvl::StatementType type, const std::vector<gvl::Token>& tokens)
@@ -116,7 +144,8 @@ static gvl::Expression set_statement_expression(gvl::StatementType type, const s
         expression.left = tokens[2];
         const std::size_t sz = tokens.size();
 
-        if (!valid_stmt_tokens_no(3, 5, sz))
+        // $str_replace text from to, the last operand is read from the line
+        if (expression.left == "$str_replace" ? sz != 6 : !valid_stmt_tokens_no(3, 5, sz))
             throw gvl::Parser::ParseTimeError{ "invalid number of tokens", gvl::Parser::get_line_no() };
 
         if (sz >= 4)
@@ -131,7 +160,7 @@ static gvl::Expression set_statement_expression(gvl::StatementType type, const s
         expression.left = tokens[3];
         const std::size_t sz = tokens.size();
 
-        if (!valid_stmt_tokens_no(4, 6, sz))
+        if (expression.left == "$str_replace" ? sz != 7 : !valid_stmt_tokens_no(4, 6, sz))
             throw gvl::Parser::ParseTimeError{ "invalid number of tokens", gvl::Parser::get_line_no() };
 
         if (sz >= 5)
@@ -145,12 +174,15 @@ static gvl::Expression set_statement_expression(gvl::StatementType type, const s
     {
         const std::size_t sz = tokens.size();
 
-        if (!valid_stmt_tokens_no(4, 7, sz))
+        if (!valid_stmt_tokens_no(4, 8, sz))
             throw gvl::Parser::ParseTimeError{ "invalid number of tokens", gvl::Parser::get_line_no() };
 
-        if (sz == 5)
+        if (sz == 4 && tokens[3] != "[]")   // var[] name = array
+            expression.left = tokens[3];
+        else if (sz == 5)
         {
-            if (tokens[3].compare("$array_pop") == 0)
+            if (tokens[3].compare("$array_pop") == 0 || tokens[3].compare("$dict_keys") == 0 ||
+                tokens[3].compare("$dict_values") == 0 || tokens[3].compare("$array_unique") == 0)
             {
                 expression.left = tokens[3];
                 expression.middle = tokens[4];
@@ -159,7 +191,9 @@ static gvl::Expression set_statement_expression(gvl::StatementType type, const s
         }
         else if (sz >= 6)
         {
-            if (tokens[3].compare("$array_at") == 0)
+            // the end of a slice is read from the line, as the expression only has room for three tokens
+            if (tokens[3].compare("$array_at") == 0 || (sz == 6 && tokens[3].compare("$array_load") == 0) ||
+                (sz == 6 && tokens[3].compare("$str_split") == 0) || (sz == 7 && tokens[3].compare("$array_slice") == 0))
             {
                 expression.left = tokens[3];
                 expression.middle = tokens[4];
@@ -174,8 +208,6 @@ static gvl::Expression set_statement_expression(gvl::StatementType type, const s
                 expression.middle = tokens[5];
                 if (sz == 8)
                     expression.right = tokens[6];
-                else
-                    throw gvl::Parser::ParseTimeError{ "invalid number of tokens", gvl::Parser::get_line_no() };
             }
         }
     }
@@ -192,7 +224,8 @@ static gvl::Expression set_statement_expression(gvl::StatementType type, const s
             throw gvl::Parser::ParseTimeError{ "invalid number of tokens", gvl::Parser::get_line_no() };
 
     }
-    else if (type == gvl::StatementType::ARRAY_SET)
+    else if (type == gvl::StatementType::ARRAY_SET || type == gvl::StatementType::ARRAY_SAVE ||
+             type == gvl::StatementType::DICT_SET)
     {
         const std::size_t sz = tokens.size();
 
@@ -206,21 +239,134 @@ static gvl::Expression set_statement_expression(gvl::StatementType type, const s
             throw gvl::Parser::ParseTimeError{ "invalid number of tokens", gvl::Parser::get_line_no() };
 
     }
-    else if (type == gvl::StatementType::DEF_FUNC)  // function name : arg1 arg2 arg3 {
+    else if (type == gvl::StatementType::ARRAY_SORT)     // $array_sort name [asc | desc]
+    {
+        const std::size_t sz = tokens.size();
+
+        if (sz != 2 && sz != 3)
+            throw gvl::Parser::ParseTimeError{ "invalid number of tokens", gvl::Parser::get_line_no() };
+
+        if (sz == 3 && tokens[2] != "asc" && tokens[2] != "desc")
+            throw gvl::Parser::ParseTimeError{ "invalid sort order", gvl::Parser::get_line_no() };
+
+        expression.left = tokens[1];
+        if (sz == 3)
+            expression.middle = tokens[2];
+    }
+    else if (type == gvl::StatementType::DICT_INIT || type == gvl::StatementType::DICT_REMOVE)   // dict name | $dict_remove name key
     {
         const std::size_t sz = tokens.size();
 
+        if (sz != (type == gvl::StatementType::DICT_INIT ? 2 : 3))
+            throw gvl::Parser::ParseTimeError{ "invalid number of tokens", gvl::Parser::get_line_no() };
+
+        expression.left = tokens[1];
+        if (sz == 3)
+            expression.middle = tokens[2];
+    }
+    else if (type == gvl::StatementType::DEF_FUNC)  // [pure] [noinline] [generator] function name : arg1 arg2 arg3 {
+    {
+        const std::size_t first = std::find(tokens.begin(), tokens.end(), "function") - tokens.begin();
+        const std::size_t sz = tokens.size() - first;
+        std::set<gvl::TokenSv> annotations;
+
+        if (first == tokens.size())
+            throw gvl::Parser::ParseTimeError{ "invalid statement type", gvl::Parser::get_line_no() };
+
+        for (std::size_t i = 0; i < first; ++i)
+        {
+            if ((tokens[i] != "pure" && tokens[i] != "noinline" && tokens[i] != "generator") || !annotations.insert(tokens[i]).second)
+                throw gvl::Parser::ParseTimeError{ "invalid statement type", gvl::Parser::get_line_no() };
+        }
+
+        if (annotations.contains("pure") && annotations.contains("generator"))
+            throw gvl::Parser::ParseTimeError{ "generator function can not be pure", gvl::Parser::get_line_no() };
+
         if (sz >= 4)
         {
-            expression.left = tokens[3];
+            expression.left = tokens[first + 3];
             if (sz >= 5)
             {
-                expression.middle = tokens[4];
+                expression.middle = tokens[first + 4];
                 if (sz >= 6)
-                    expression.right = tokens[5];
+                    expression.right = tokens[first + 5];
             }
         }
     }
+    else if (type == gvl::StatementType::PFOR)      // pfor element in array [reduce op:var ...] {
+    {
+        const std::size_t sz = tokens.size();
+
+        if (sz < 5 || tokens[2] != "in" || tokens.back() != "{" || (sz > 5 && tokens[4] != "reduce"))
+            throw gvl::Parser::ParseTimeError{ "invalid pfor statement", gvl::Parser::get_line_no() };
+
+        gvl::Parser::get_pfor_reductions(tokens);
+
+        expression.left = tokens[1];
+        expression.middle = tokens[3];
+    }
+    else if (type == gvl::StatementType::FOR_LINES)     // for line in stdin {  |  for line in file path {
+    {
+        const std::size_t sz = tokens.size();
+        const bool from_stdin = sz == 5 && tokens[3] == "stdin";
+        const bool from_file = sz == 6 && tokens[3] == "file";
+
+        if ((!from_stdin && !from_file) || tokens[2] != "in" || tokens.back() != "{")
+            throw gvl::Parser::ParseTimeError{ "invalid for statement", gvl::Parser::get_line_no() };
+
+        expression.left = tokens[1];
+        expression.middle = tokens[3];
+        if (from_file)
+            expression.right = tokens[4];
+    }
+    else if (type == gvl::StatementType::FOR_GENERATOR)     // for value in call name arg1 arg2 arg3 {
+    {
+        const std::size_t sz = tokens.size();
+
+        if (!valid_stmt_tokens_no(6, 9, sz) || tokens[2] != "in" || tokens.back() != "{")
+            throw gvl::Parser::ParseTimeError{ "invalid for statement", gvl::Parser::get_line_no() };
+
+        expression.left = tokens[1];
+        expression.middle = tokens[4];
+    }
+    else if (type == gvl::StatementType::YIELD)     // yield value
+    {
+        if (tokens.size() != 2)
+            throw gvl::Parser::ParseTimeError{ "invalid number of tokens", gvl::Parser::get_line_no() };
+
+        expression.left = tokens[1];
+    }
+    else if (type == gvl::StatementType::SPAWN)     // spawn handle call name arg1 arg2 arg3
+    {
+        const std::size_t sz = tokens.size();
+
+        if (!valid_stmt_tokens_no(4, 7, sz) || tokens[2] != "call")
+            throw gvl::Parser::ParseTimeError{ "invalid spawn statement", gvl::Parser::get_line_no() };
+
+        expression.left = tokens[1];
+        expression.middle = tokens[3];
+    }
+    else if (type == gvl::StatementType::AWAIT || type == gvl::StatementType::CHANNEL_INIT ||
+             type == gvl::StatementType::CHANNEL_SEND || type == gvl::StatementType::CHANNEL_RECV ||
+             type == gvl::StatementType::CHANNEL_CLOSE)
+    {
+        // await task | channel name capacity | send channel value | recv channel var [ok_var] | close channel
+        const std::size_t sz = tokens.size();
+        const bool valid = 
+            type == gvl::StatementType::AWAIT || type == gvl::StatementType::CHANNEL_CLOSE ? sz == 2 :
+            type == gvl::StatementType::CHANNEL_RECV ? valid_stmt_tokens_no(3, 4, sz) : sz == 3;
+
+        if (!valid)
+            throw gvl::Parser::ParseTimeError{ "invalid number of tokens", gvl::Parser::get_line_no() };
+
+        expression.left = tokens[1];
+        if (sz >= 3)
+        {
+            expression.middle = tokens[2];
+            if (sz >= 4)
+                expression.right = tokens[3];
+        }
+    }
     else if (type == gvl::StatementType::CALL_FUNC)     // call name arg1 arg2 arg3
     {
         const std::size_t sz = tokens.size();
@@ -236,7 +382,7 @@ static gvl::Expression set_statement_expression(gvl::StatementType type, const s
             }
         }
     }
-    else if (type != gvl::StatementType::ELSE && type != gvl::StatementType::BRACKET)
+    else if (type != gvl::StatementType::ELSE && type != gvl::StatementType::BRACKET && tokens.size() > 1)
     {
         expression.left = tokens[1];
         const std::size_t sz = tokens.size();
@@ -252,15 +398,49 @@ static gvl::Expression set_statement_expression(gvl::StatementType type, const s
     return expression;
 }
 
-static std::vector<gvl::Statement> set_statement_body(const std::vector<std::string>& lines, auto& it)
+gvl::Parser::Blocks gvl::Parser::index_blocks(LineIter begin, LineIter end)
 {
-    std::vector<gvl::Statement> body;
-    std::vector<std::string> sub_lines;
+    Blocks blocks{ begin, std::vector<std::size_t>(end - begin, no_closer) };
+    std::vector<std::size_t> open;
+
+    for (auto it = begin; it != end; ++it)
+    {
+        if ((*it).empty())
+            continue;
+
+        if ((*it).back() == '}')
+        {
+            if (!open.empty())
+            {
+                blocks.closers[open.back()] = it - begin;
+                open.pop_back();
+            }
+        }
+        else if ((*it).back() == '{')
+            open.push_back(it - begin);
+    }
+
+    return blocks;
+}
+
+gvl::Parser::LineIter gvl::Parser::skip_body(LineIter& it, LineIter end, const Blocks& blocks)
+{
+    const std::size_t closer = blocks.closers[it - blocks.first];
+    const LineIter begin = ++it;
+
+    if (closer != no_closer)
+    {
+        it = blocks.first + closer;
+        return begin;
+    }
+
     std::size_t cbracket_cnt = 1;
-    ++it;
 
-    for (; it != lines.end(); ++it)
+    for (; it != end; ++it)
     {
+        if ((*it).empty())
+            continue;
+
         if ((*it).back() == '}')
         {
             --cbracket_cnt;
@@ -269,44 +449,412 @@ static std::vector<gvl::Statement> set_statement_body(const std::vector<std::str
         }
         else if ((*it).back() == '{')
             ++cbracket_cnt;
+    }
+
+    return begin;
+}
+
+std::vector<gvl::Parser::Reduction> gvl::Parser::get_pfor_reductions(const std::vector<Token>& tokens)
+{
+    std::vector<Reduction> reductions;
+
+    for (std::size_t i = 5; i + 1 < tokens.size(); ++i)
+    {
+        const Token& spec = tokens[i];
+        const std::size_t colon = spec.find(':');
 
-        sub_lines.push_back(*it);
+        if (colon == Token::npos || colon + 1 == spec.size())
+            throw ParseTimeError{ "invalid pfor reduction '" + spec + "'", get_line_no() };
+
+        Reduction reduction(spec.substr(0, colon), spec.substr(colon + 1));
+
+        if (reduction.first != "sum" && reduction.first != "min" && reduction.first != "max")
+            throw ParseTimeError{ "invalid pfor reduction '" + spec + "'", get_line_no() };
+
+        reductions.push_back(reduction);
     }
 
-    gvl::Parser p(sub_lines, nullptr);
-    body = p.get_parsed_program().statements;
-    
-    return body;
+    return reductions;
 }
 
-gvl::Parser::Parser(const std::vector<std::string>& lines, const std::array<std::string, gvl::args_max_num>* args)
+static void collect_locals(const std::vector<gvl::Statement>& body, std::set<gvl::TokenSv>& locals)
 {
-    if (args != nullptr)
-        this->parsed_program.args = *args;
+    using gvl::StatementType;
 
-    for (auto it = lines.begin(); it != lines.end(); ++it)
+    for (const gvl::Statement& stmt : body)
     {
-        if ((*it).empty())
+        if (stmt.type == StatementType::INIT || stmt.type == StatementType::CONST || stmt.type == StatementType::ARRAY_INIT ||
+            stmt.type == StatementType::DICT_INIT)
+            locals.insert(stmt.line[1]);
+        else if (stmt.type == StatementType::PFOR || stmt.type == StatementType::FOR_LINES ||
+                 stmt.type == StatementType::FOR_GENERATOR)
+            locals.insert(stmt.expression.left);
+
+        collect_locals(stmt.main_body, locals);
+    }
+}
+
+// throws with the message forbidden returns for a statement of body, nullptr allows it
+static void forbid_statements(const std::vector<gvl::Statement>& body, const auto& forbidden, std::size_t line_no)
+{
+    for (const gvl::Statement& stmt : body)
+    {
+        if (const char* error_msg = forbidden(stmt))
+            throw gvl::Parser::ParseTimeError{ error_msg, line_no };
+
+        forbid_statements(stmt.main_body, forbidden, line_no);
+    }
+}
+
+// what names the checked body in the error, e.g. "pfor body"
+static void check_local_writes(const std::vector<gvl::Statement>& body, const std::set<gvl::TokenSv>& locals,
+    const std::string& what, std::size_t line_no)
+{
+    using gvl::StatementType;
+
+    auto check = [&locals, &what, line_no](gvl::TokenSv name)
+    {
+        if (!name.empty() && !locals.contains(name))
+            throw gvl::Parser::ParseTimeError{ what + " writes to outer variable '" + gvl::Token(name) + "'", line_no };
+    };
+
+    for (const gvl::Statement& stmt : body)
+    {
+        if (stmt.type == StatementType::AWAIT || stmt.type == StatementType::CHANNEL_INIT)
+            check(stmt.expression.left);
+        else if (stmt.type == StatementType::CHANNEL_RECV)
         {
-            ++this->line_no;
-            continue;
+            check(stmt.expression.middle);
+            check(stmt.expression.right);
+        }
+        else if (stmt.type == StatementType::ASSIGN)
+            check(stmt.line.front());
+        else if (stmt.type == StatementType::ARRAY_APPEND || stmt.type == StatementType::ARRAY_SET || stmt.type == StatementType::ARRAY_POP ||
+                 stmt.type == StatementType::ARRAY_SORT || stmt.type == StatementType::DICT_SET || stmt.type == StatementType::DICT_REMOVE)
+            check(stmt.line[1]);
+        else if (stmt.type == StatementType::READCHAR || stmt.type == StatementType::READINT || stmt.type == StatementType::READFLOAT ||
+                 stmt.type == StatementType::READSTR || stmt.type == StatementType::READLN)
+        {
+            check(stmt.expression.left);
+            check(stmt.expression.middle);
+            check(stmt.expression.right);
+        }
+        else if (stmt.type == StatementType::PFOR)
+        {
+            for (const auto& reduction : gvl::Parser::get_pfor_reductions(stmt.line))
+                check(reduction.second);
+        }
+
+        if ((stmt.type == StatementType::INIT || stmt.type == StatementType::ARRAY_INIT) && stmt.expression.left == "$array_pop")
+            check(stmt.expression.middle);
+
+        check_local_writes(stmt.main_body, locals, what, line_no);
+    }
+}
+
+// every name a pure function reads has to be one of its parameters or locals, so that its
+// results only depend on the arguments
+static void check_local_reads(const std::vector<gvl::Statement>& body, const std::set<gvl::TokenSv>& locals, std::size_t line_no)
+{
+    using gvl::StatementType;
+
+    for (const gvl::Statement& stmt : body)
+    {
+        // the first token is the statement's keyword, or the assigned variable
+        for (std::size_t i = 1; i < stmt.line.size(); ++i)
+        {
+            gvl::TokenSv name = stmt.line[i];
+
+            if (stmt.type == StatementType::CALL_FUNC && i == 1)
+                continue;
+
+            // reduce clauses of pfor statements, e.g. sum:total
+            if (stmt.type == StatementType::PFOR && name.find(':') != gvl::TokenSv::npos)
+                name.remove_prefix(name.find(':') + 1);
+
+            if (name.empty() || !(std::isalpha(static_cast<unsigned char>(name.front())) || name.front() == '_'))
+                continue;
+
+            if (name == "true" || name == "false" || name == "and" || name == "or" || name == "in" || name == "reduce")
+                continue;
+
+            if (!locals.contains(name))
+                throw gvl::Parser::ParseTimeError{ "pure function reads outer variable '" + gvl::Token(name) + "'", line_no };
+        }
+
+        check_local_reads(stmt.main_body, locals, line_no);
+    }
+}
+
+// iterations run concurrently on private copies of the variables, so only
+// locals of the body and the reduction variables may be written to
+static void validate_pfor_body(const gvl::Statement& stmt, std::size_t line_no)
+{
+    const std::vector<gvl::Parser::Reduction> reductions = gvl::Parser::get_pfor_reductions(stmt.line);
+    std::set<gvl::TokenSv> locals{ stmt.expression.left };
+
+    for (const auto& reduction : reductions)
+        locals.insert(reduction.second);
+
+    collect_locals(stmt.main_body, locals);
+
+    forbid_statements(stmt.main_body, [](const gvl::Statement& sub_stmt) -> const char*
+    {
+        const bool call = sub_stmt.type == gvl::StatementType::CALL_FUNC || sub_stmt.type == gvl::StatementType::DEF_FUNC ||
+            sub_stmt.type == gvl::StatementType::SPAWN || sub_stmt.type == gvl::StatementType::FOR_GENERATOR;
+
+        return call ? "functions can not be called or defined in a pfor body" :
+            sub_stmt.type == gvl::StatementType::YIELD ? "yield can not be used in a pfor body" : nullptr;
+    }, line_no);
+
+    check_local_writes(stmt.main_body, locals, "pfor body", line_no);
+}
+
+// results of pure functions are memoized, so their bodies may not do I/O, call other functions or
+// touch variables besides their parameters and locals
+static void validate_pure_function(const gvl::Statement& stmt, std::size_t line_no)
+{
+    using gvl::StatementType;
+
+    const gvl::Token& name = gvl::Parser::get_function_name(stmt);
+    std::set<gvl::TokenSv> locals;
+
+    for (const gvl::Token* param : { &stmt.expression.left, &stmt.expression.middle, &stmt.expression.right })
+    {
+        if (!param->empty())
+            locals.insert(*param);
+    }
+
+    collect_locals(stmt.main_body, locals);
+
+    forbid_statements(stmt.main_body, [&name](const gvl::Statement& sub_stmt) -> const char*
+    {
+        switch (sub_stmt.type)
+        {
+            case StatementType::READCHAR:
+            case StatementType::READINT:
+            case StatementType::READFLOAT:
+            case StatementType::READSTR:
+            case StatementType::READLN:
+            case StatementType::PRINT:
+            case StatementType::PRINTLN:
+            case StatementType::ARRAY_SAVE:
+            case StatementType::FOR_LINES:
+                return "pure function can not read or write";
+            case StatementType::SPAWN:
+            case StatementType::AWAIT:
+            case StatementType::CHANNEL_INIT:
+            case StatementType::CHANNEL_SEND:
+            case StatementType::CHANNEL_RECV:
+            case StatementType::CHANNEL_CLOSE:
+                return "pure function can not use tasks or channels";
+            case StatementType::DEF_FUNC:
+                return "functions can not be defined in a pure function";
+            case StatementType::CALL_FUNC:
+                return sub_stmt.line[1] == name ? nullptr : "pure function can only call itself";
+            case StatementType::FOR_GENERATOR:
+                return "pure function can only call itself";
+            case StatementType::ARRAY_INIT:
+                return sub_stmt.expression.left == "$array_load" ? "pure function can not read or write" : nullptr;
+            default:
+                return nullptr;
         }
+    }, line_no);
 
+    check_local_writes(stmt.main_body, locals, "pure function", line_no);
+    check_local_reads(stmt.main_body, locals, line_no);
+}
+
+// yield statements belong to the innermost function around them, which has to be a generator
+static void check_yields(const std::vector<gvl::Statement>& body, bool in_generator)
+{
+    for (const gvl::Statement& stmt : body)
+    {
+        if (stmt.type == gvl::StatementType::YIELD && !in_generator)
+            throw gvl::Parser::ParseTimeError{ "yield outside of a generator function", stmt.line_no };
+
+        check_yields(stmt.main_body, stmt.type == gvl::StatementType::DEF_FUNC ? gvl::Parser::is_generator_function(stmt) : in_generator);
+    }
+}
+
+// a script has at most one checkpoint, which has to be one of its top-level statements
+static void check_checkpoints(const std::vector<gvl::Statement>& body, bool top_level)
+{
+    std::size_t count = 0;
+
+    for (const gvl::Statement& stmt : body)
+    {
+        if (stmt.type == gvl::StatementType::CHECKPOINT && (!top_level || ++count > 1))
+            throw gvl::Parser::ParseTimeError{ top_level ? "a script can have only one checkpoint" : "checkpoint outside of the top level", stmt.line_no };
+
+        check_checkpoints(stmt.main_body, false);
+        check_checkpoints(stmt.second_body, false);
+    }
+}
+
+// a top-level line starting with one of these opens a block, whatever it ends with
+static bool opens_block(const std::string& line)
+{
+    static const std::set<std::string_view> keywords{ "if", "else", "while", "pfor", "for", "function", "pure", "noinline", "generator" };
+
+    const std::size_t first = line.find_first_not_of(" \t");
+    if (first == std::string::npos)
+        return false;
+
+    const std::string_view rest = std::string_view(line).substr(first);
+    return keywords.contains(rest.substr(0, rest.find_first_of(" \t")));
+}
+
+std::vector<gvl::Statement> gvl::Parser::parse_lines(LineIter begin, LineIter end, const Blocks& blocks,
+    const std::shared_ptr<const Lines>* script)
+{
+    std::vector<Statement> statements;
+
+    for (auto it = begin; it != end; ++it)
+    {
         Statement stmt;
 
         stmt.line = split_string_into_vector(*it);
 
         if (stmt.line.empty())
+        {
+            ++line_no;
             continue;
+        }
 
         stmt.type = set_statement_type(stmt.line);
         
         stmt.expression = set_statement_expression(stmt.type, stmt.line);
 
+        const std::size_t stmt_line_no = line_no;
+        stmt.line_no = stmt_line_no;
+
+        // the body starts on the line after the header, its parser goes on counting from there
         if (statement_is_block(stmt.type))
-            stmt.main_body = set_statement_body(lines, it);
+        {
+            ++line_no;
+            const LineIter body = skip_body(it, end, blocks);
+
+            // pure functions are checked against their bodies right away
+            if (script != nullptr && stmt.type == StatementType::DEF_FUNC && !is_pure_function(stmt))
+            {
+                stmt.unparsed_body = std::make_shared<const SourceRange>(SourceRange{ *script,
+                    static_cast<std::size_t>(body - (*script)->begin()), static_cast<std::size_t>(it - (*script)->begin()), line_no });
+                line_no += it - body;
+            }
+            else
+                stmt.main_body = parse_lines(body, it, blocks);
+        }
+
+        if (stmt.type == StatementType::PFOR)
+            validate_pfor_body(stmt, stmt_line_no);
+        else if (stmt.type == StatementType::DEF_FUNC && is_pure_function(stmt))
+            validate_pure_function(stmt, stmt_line_no);
 
-        this->parsed_program.statements.push_back(stmt);
-        ++this->line_no;
+        statements.push_back(std::move(stmt));
+        ++line_no;
+
+        // a block that is never closed takes the rest of the lines
+        if (it == end)
+            break;
     }
-}
\ No newline at end of file
+
+    return statements;
+}
+
+// top-level statements only depend on their own lines, so every piece is parsed on its own, counting lines
+// from where it starts; the first error in line order is the one reported
+std::vector<gvl::Statement> gvl::Parser::parse_in_parallel(const std::shared_ptr<const Lines>& script)
+{
+    const Lines& lines = *script;
+    ThreadPool& pool = ThreadPool::shared();
+    const std::size_t piece_lines = std::max(parallel_lines, lines.size() / (4 * pool.get_threads_no()));
+
+    std::vector<std::size_t> starts{ 0 };
+    std::size_t depth = 0;
+
+    for (std::size_t i = 0; i < lines.size(); ++i)
+    {
+        const std::string& line = lines[i];
+
+        if (depth == 0 ? opens_block(line) : !line.empty() && line.back() == '{')
+            ++depth;
+        else if (depth > 0 && !line.empty() && line.back() == '}')
+            --depth;
+
+        if (depth == 0 && i + 1 - starts.back() >= piece_lines && i + 1 < lines.size())
+            starts.push_back(i + 1);
+    }
+    starts.push_back(lines.size());
+
+    const Blocks blocks = index_blocks(lines.begin(), lines.end());
+    const std::size_t first_line_no = line_no;
+    std::vector<std::vector<Statement>> pieces(starts.size() - 1);
+    std::vector<std::exception_ptr> errors(pieces.size());
+
+    pool.parallel_for(pieces.size(), pieces.size(), [&](std::size_t begin, std::size_t end, std::size_t)
+    {
+        for (std::size_t piece = begin; piece < end; ++piece)
+        {
+            line_no = first_line_no + starts[piece];
+
+            try
+            {
+                pieces[piece] = parse_lines(lines.begin() + starts[piece], lines.begin() + starts[piece + 1], blocks, &script);
+            }
+            catch (...)
+            {
+                errors[piece] = std::current_exception();
+            }
+        }
+    });
+
+    line_no = first_line_no + lines.size();
+
+    for (const std::exception_ptr& error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    std::vector<Statement> statements;
+    for (std::vector<Statement>& piece : pieces)
+        statements.insert(statements.end(), std::make_move_iterator(piece.begin()), std::make_move_iterator(piece.end()));
+
+    return statements;
+}
+
+gvl::Parser::Parser(const std::vector<std::string>& lines, const std::array<std::string, gvl::args_max_num>* args)
+{
+    if (args != nullptr)
+        this->parsed_program.args = *args;
+
+    // function bodies parsed later refer to the lines, which outlive the caller's
+    const auto script = std::make_shared<const Lines>(lines);
+
+    this->parsed_program.statements = lines.size() < 2 * parallel_lines ?
+        parse_lines(script->begin(), script->end(), index_blocks(script->begin(), script->end()), &script) : parse_in_parallel(script);
+
+    check_yields(this->parsed_program.statements, false);
+    check_checkpoints(this->parsed_program.statements, true);
+}
+
+void gvl::Parser::parse_function_body(Statement& function)
+{
+    if (!function.unparsed_body)
+        return;
+
+    const SourceRange& range = *function.unparsed_body;
+
+    line_no = range.line_no;
+    const LineIter begin = range.lines->begin() + range.begin;
+    const LineIter end = range.lines->begin() + range.end;
+
+    std::vector<Statement> body = parse_lines(begin, end, index_blocks(begin, end));
+
+    check_yields(body, is_generator_function(function));
+    check_checkpoints(body, false);
+
+    function.main_body = std::move(body);
+    function.unparsed_body.reset();
+}
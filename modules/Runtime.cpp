@@ -0,0 +1,154 @@
+#include "../includes/Runtime.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+
+
+static std::unique_ptr<gvl::Interpreter> make_scope(const std::array<gvl::Token, gvl::args_max_num>& args)
+{
+    gvl::Program program;
+    program.args = args;
+    return std::make_unique<gvl::Interpreter>(program);
+}
+
+gvl::Runtime::Runtime(int argc, char** argv)
+{
+    for (int i = 1; i < argc && i <= args_max_num; ++i)
+        this->args[i - 1] = argv[i];
+
+    this->scopes.push_back(make_scope(this->args));
+}
+
+bool gvl::Runtime::Loop::next()
+{
+    if (this->started)
+        this->hot_loop.count_iteration();
+
+    this->started = true;
+
+    if (this->hot_loop.tier_up())
+        return false;
+
+    return this->runtime.condition(this->stmt);
+}
+
+bool gvl::Runtime::Lines::next()
+{
+    Interpreter& scope = this->runtime.at(this->stmt);
+    std::string_view line;
+
+    if (!this->reader.next(line))
+        return false;
+
+    Interpreter::set_line(scope, this->stmt.expression.left, line);
+    return true;
+}
+
+bool gvl::Runtime::Yields::next()
+{
+    Interpreter& scope = this->runtime.at(this->stmt);
+    Token value;
+
+    if (!this->generator.next(value))
+        return false;
+
+    Interpreter::set_line(scope, this->stmt.expression.left, value);
+    return true;
+}
+
+void gvl::Runtime::enter_scope()
+{
+    ++Interpreter::block_lvl;
+    this->scopes.push_back(make_scope(this->args));
+
+    // blocks of a function body bind its names as the body does
+    this->scopes.back()->slots = this->scopes[this->scopes.size() - 2]->slots;
+}
+
+void gvl::Runtime::leave_scope()
+{
+    --Interpreter::block_lvl;
+    Interpreter::clear_scope(scope(), scope().tmp_var_names);
+    this->scopes.pop_back();
+}
+
+void gvl::Runtime::define(Statement& stmt, BlockFunc body)
+{
+    this->functions.emplace(Parser::get_function_name(stmt), std::pair<Statement*, BlockFunc>(&stmt, body));
+
+    // spawned calls run the interpreted body on the thread pool
+    Interpreter::register_function(stmt);
+}
+
+void gvl::Runtime::call(const Statement& stmt)
+{
+    this->line_no = stmt.line_no;
+
+    const auto it = this->functions.find(stmt.line[1]);
+
+    if (it == this->functions.end())
+        throw Interpreter::RunTimeError(Interpreter::ErrorCode::UNDEFINED_FUNCTION,
+            "call of undefined function '" + stmt.line[1] + "'", stmt.line_no);
+
+    const Interpreter& caller = scope();
+    const std::array<Token, 3> arguments{ caller.bound(stmt.expression.left), caller.bound(stmt.expression.middle),
+        caller.bound(stmt.expression.right) };
+    MemoCache* memo = Parser::is_pure_function(*(it->second.first)) ? Interpreter::find_memo(stmt.line[1]) : nullptr;
+    std::array<bool, 3> is_variable;
+    std::vector<Token> results;
+    Token key;
+
+    if (memo != nullptr && !Interpreter::memo_key(arguments, key, is_variable))
+        memo = nullptr;
+
+    if (memo != nullptr && memo->lookup(key, results))
+    {
+        Interpreter::apply_memo(arguments, results);
+        return;
+    }
+
+    // activations share the bound body, each names its slots, so recursive calls keep their variables apart
+    const std::shared_ptr<const Interpreter::BoundFunction> bound = Interpreter::bind_function(*(it->second.first));
+    const std::vector<Token> slots = Interpreter::name_slots(*bound, arguments, "@" + std::to_string(++this->activations_no));
+
+    ++this->calls_depth;
+    enter_scope();
+    scope().slots = &slots;
+    it->second.second(*this, const_cast<Program::StmtContainer&>(bound->function.main_body));
+    leave_scope();
+    --this->calls_depth;
+
+    if (memo != nullptr && Interpreter::memo_results(arguments, is_variable, results))
+        memo->store(key, results);
+}
+
+void gvl::Runtime::finish() const
+{
+    this->scopes.front()->print_vars();
+}
+
+int gvl::Runtime::run(BlockFunc block, Program::StmtContainer& statements)
+{
+    try
+    {
+        try
+        {
+            block(*this, statements);
+        }
+        catch (...)
+        {
+            Interpreter::rethrow_runtime_error(this->line_no);
+        }
+
+        finish();
+    }
+    catch (const Interpreter::RunTimeError& e)
+    {
+        Interpreter::get_output_stream() << std::flush;
+        std::cerr << "runtime error: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include "../includes/Script.hpp"
+#include "../includes/Optimizer.hpp"
+#include <string>
+#include <sstream>
+#include <vector>
+#include <cassert>
+
+
+// every function body is parsed up front, runs share the program and never change it
+static gvl::Program compile(const std::vector<std::string>& lines)
+{
+    gvl::Parser::reset_line_no();
+    gvl::Parser parser(lines, nullptr);
+    gvl::Program program(parser.get_parsed_program());
+
+    for (gvl::Statement& stmt : program.statements)
+    {
+        if (stmt.type == gvl::StatementType::DEF_FUNC)
+            gvl::Parser::parse_function_body(stmt);
+    }
+
+    gvl::Optimizer::optimize(program);
+    return program;
+}
+
+gvl::Script gvl::Script::from_source(const std::string& source)
+{
+    std::istringstream iss(source);
+    return Script(compile(Parser::split_to_lines(iss)));
+}
+
+gvl::Script gvl::Script::from_file(const std::string& file_name)
+{
+    std::vector<char> buffer;
+    std::istringstream iss(Parser::read_file_content(file_name, buffer));
+    return Script(compile(Parser::split_to_lines(iss)));
+}
+
+gvl::Execution& gvl::Execution::set_args(const std::vector<Token>& args)
+{
+    assert(args.size() <= args_max_num);
+
+    this->args = {};
+    std::copy(args.begin(), args.end(), this->args.begin());
+
+    return *this;
+}
+
+gvl::Execution& gvl::Execution::set_variable(const Token& name, const Token& value)
+{
+    VarLike varlike;
+    varlike.value = value;
+    varlike.type = Interpreter::deduce_type(value);
+
+    this->injected.emplace_back(name, varlike);
+    return *this;
+}
+
+gvl::Execution& gvl::Execution::set_array(const Token& name, const std::vector<Token>& elements)
+{
+    VarLike varlike;
+    varlike.value = name;
+    varlike.type = VarLikeType::ARRAY;
+    varlike.array_elements = elements;
+
+    this->injected.emplace_back(name, varlike);
+    return *this;
+}
+
+gvl::Execution& gvl::Execution::set_input(std::istream& in)
+{
+    this->input = &in;
+    return *this;
+}
+
+gvl::Execution& gvl::Execution::capture_output()
+{
+    this->capture = true;
+    return *this;
+}
+
+gvl::Execution& gvl::Execution::set_max_statements(std::uint64_t value)
+{
+    this->limits.statements = value;
+    return *this;
+}
+
+gvl::Execution& gvl::Execution::set_max_time(std::uint64_t milliseconds)
+{
+    this->limits.time = milliseconds;
+    return *this;
+}
+
+gvl::Execution& gvl::Execution::set_max_cpu_time(std::uint64_t milliseconds)
+{
+    this->limits.cpu_time = milliseconds;
+    return *this;
+}
+
+gvl::Execution& gvl::Execution::set_max_memory(std::uint64_t bytes)
+{
+    this->limits.memory = bytes;
+    return *this;
+}
+
+namespace
+{
+    // runs the calling thread in a context of the run's own with this run's streams, and leaves no state
+    // behind, even if the script throws
+    class RunGuard
+    {
+        public:
+
+            RunGuard(std::ostream& out, std::istream& in)
+                : context(gvl::Interpreter::make_context()), prev_context(gvl::Interpreter::get_context())
+            {
+                gvl::Interpreter::set_context(this->context.get());
+                gvl::Interpreter::reset_state();
+                gvl::Interpreter::set_output_stream(out);
+                gvl::Interpreter::set_input_stream(in);
+            }
+
+            ~RunGuard()
+            {
+                gvl::Interpreter::reset_state();
+                gvl::Interpreter::set_context(this->prev_context);
+            }
+
+        private:
+
+            std::shared_ptr<gvl::Interpreter::Context> context;
+            gvl::Interpreter::Context* prev_context;
+    };
+}
+
+void gvl::Execution::run()
+{
+    std::ostringstream captured;
+    RunGuard guard(this->capture ? captured : std::cout, *this->input);
+
+    Interpreter interpreter(*this->program, this->args);
+
+    for (auto& [ name, varlike ] : this->injected)
+    {
+        varlike.name = name;
+        Interpreter::variables[varlike.name] = varlike;
+    }
+
+    if (this->limits.any())
+        Interpreter::start_budget(this->limits);
+
+    interpreter.execute_program();
+
+    this->results.clear();
+
+    for (const auto& [ name, varlike ] : Interpreter::variables)
+    {
+        const auto& [ it, inserted ] = this->results.insert_or_assign(Token(name), varlike);
+        it->second.name = it->first;
+    }
+
+    this->output = captured.str();
+}
+
+const gvl::VarLike& gvl::Execution::get_variable(const Token& name) const
+{
+    return this->results.at(name);
+}
+
+long long gvl::Execution::get_int(const Token& name) const
+{
+    return std::stoll(get_variable(name).value);
+}
+
+double gvl::Execution::get_double(const Token& name) const
+{
+    return std::stod(get_variable(name).value);
+}
+
+const gvl::Token& gvl::Execution::get_string(const Token& name) const
+{
+    return get_variable(name).value;
+}
+
+std::vector<gvl::Token> gvl::Execution::get_array(const Token& name) const
+{
+    const ArrayStorage& elements = get_variable(name).array_elements;
+    return std::vector<Token>(elements.begin(), elements.end());
+}
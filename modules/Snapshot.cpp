@@ -0,0 +1,266 @@
+#include "../includes/Snapshot.hpp"
+#include "../includes/Interpreter.hpp"
+#include "../includes/MappedFile.hpp"
+#include <cstring>
+#include <algorithm>
+#include <bit>
+#include <deque>
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+
+
+std::string gvl::Snapshot::save_file;
+std::string gvl::Snapshot::load_file;
+std::uint64_t gvl::Snapshot::script_key = 0;
+
+static constexpr char magic[] = "GVLSNAP1";
+static constexpr std::size_t magic_size = sizeof(magic) - 1;
+
+// names of the restored variables, the variable map only holds views of them
+static std::deque<gvl::Token> restored_names;
+
+
+static void hash_bytes(std::uint64_t& hash, std::string_view bytes)
+{
+    for (unsigned char c : bytes)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+
+    // ends the field, so "ab" "c" and "a" "bc" differ
+    hash ^= 0xff;
+    hash *= 0x100000001b3ull;
+}
+
+static void hash_statement(std::uint64_t& hash, const gvl::Statement& stmt)
+{
+    hash_bytes(hash, std::to_string(static_cast<int>(stmt.type)));
+
+    for (const gvl::Token& token : stmt.line)
+        hash_bytes(hash, token);
+
+    if (stmt.unparsed_body)
+    {
+        const gvl::SourceRange& range = *stmt.unparsed_body;
+
+        for (std::size_t i = range.begin; i < range.end; ++i)
+            hash_bytes(hash, (*range.lines)[i]);
+    }
+
+    for (const gvl::Statement& sub_stmt : stmt.main_body)
+        hash_statement(hash, sub_stmt);
+
+    hash_bytes(hash, "}");
+
+    for (const gvl::Statement& sub_stmt : stmt.second_body)
+        hash_statement(hash, sub_stmt);
+
+    hash_bytes(hash, "}");
+}
+
+// FNV-1a over the arguments and the statements a checkpoint is reached by
+static std::uint64_t script_key(const gvl::Program& program, std::size_t checkpoint)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (const gvl::Token& arg : program.args)
+        hash_bytes(hash, arg);
+
+    for (std::size_t i = 0; i < checkpoint; ++i)
+        hash_statement(hash, program.statements[i]);
+
+    return hash;
+}
+
+static void write_u64(std::string& image, std::uint64_t value)
+{
+    char buffer[sizeof(value)];
+    std::memcpy(buffer, &value, sizeof(value));
+
+    if constexpr (std::endian::native == std::endian::big)
+        std::reverse(buffer, buffer + sizeof(value));
+
+    image.append(buffer, sizeof(value));
+}
+
+static void write_token(std::string& image, std::string_view token)
+{
+    write_u64(image, token.size());
+    image.append(token);
+}
+
+namespace
+{
+    // bounds checked reader over a mapped image
+    class ImageReader
+    {
+        public:
+
+            ImageReader(const gvl::MappedFile& file, const std::string& file_name)
+                : pos(file.begin()), end(file.begin() + file.get_size()), file_name(file_name)
+            {}
+
+            const char* take(std::size_t n)
+            {
+                if (static_cast<std::size_t>(this->end - this->pos) < n)
+                    throw std::runtime_error("damaged snapshot '" + this->file_name + "'");
+
+                const char* bytes = this->pos;
+                this->pos += n;
+                return bytes;
+            }
+
+            std::uint64_t read_u64()
+            {
+                char buffer[sizeof(std::uint64_t)];
+                std::memcpy(buffer, take(sizeof(buffer)), sizeof(buffer));
+
+                if constexpr (std::endian::native == std::endian::big)
+                    std::reverse(buffer, buffer + sizeof(buffer));
+
+                std::uint64_t value;
+                std::memcpy(&value, buffer, sizeof(value));
+                return value;
+            }
+
+            unsigned char read_u8() { return static_cast<unsigned char>(*take(1)); }
+
+            gvl::Token read_token()
+            {
+                const std::uint64_t size = read_u64();
+                return gvl::Token(take(size), size);
+            }
+
+            inline bool at_end() const { return this->pos == this->end; }
+
+        private:
+
+            const char* pos;
+            const char* end;
+            const std::string& file_name;
+    };
+}
+
+// every variable is read before any is set, a damaged image changes nothing
+static std::vector<gvl::VarLike> restore(const std::string& file_name, std::uint64_t key)
+{
+    gvl::MappedFile file(file_name);
+    ImageReader reader(file, file_name);
+
+    if (std::string_view(reader.take(magic_size), magic_size) != std::string_view(magic, magic_size))
+        throw std::runtime_error("'" + file_name + "' is not a snapshot");
+
+    if (reader.read_u64() != key)
+        throw std::runtime_error("snapshot '" + file_name + "' was taken of another script or with other arguments");
+
+    std::vector<gvl::VarLike> restored;
+
+    for (std::uint64_t vars_no = reader.read_u64(); vars_no > 0; --vars_no)
+    {
+        gvl::VarLike vl;
+
+        restored_names.push_back(reader.read_token());
+        vl.name = restored_names.back();
+
+        const unsigned char type = reader.read_u8();
+        if (type >= static_cast<unsigned char>(gvl::VarLikeType::NONE))
+            throw std::runtime_error("damaged snapshot '" + file_name + "'");
+
+        vl.type = static_cast<gvl::VarLikeType>(type);
+        vl.is_const = reader.read_u8() != 0;
+        vl.value = reader.read_token();
+
+        std::vector<gvl::Token> elements;
+        for (std::uint64_t elements_no = reader.read_u64(); elements_no > 0; --elements_no)
+            elements.push_back(reader.read_token());
+        vl.array_elements = gvl::ArrayStorage(std::move(elements));
+
+        for (std::uint64_t entries_no = reader.read_u64(); entries_no > 0; --entries_no)
+        {
+            const gvl::Token entry_key = reader.read_token();
+            vl.dict_entries.insert_or_assign(entry_key, reader.read_token());
+        }
+
+        restored.push_back(std::move(vl));
+    }
+
+    if (!reader.at_end())
+        throw std::runtime_error("damaged snapshot '" + file_name + "'");
+
+    return restored;
+}
+
+void gvl::Snapshot::prepare(Program& program)
+{
+    if (save_file.empty() && load_file.empty())
+        return;
+
+    auto checkpoint = std::find_if(program.statements.begin(), program.statements.end(),
+        [](const Statement& stmt) { return stmt.type == StatementType::CHECKPOINT; });
+
+    if (checkpoint == program.statements.end())
+        throw std::runtime_error("a snapshot needs a checkpoint statement in the script");
+
+    script_key = ::script_key(program, checkpoint - program.statements.begin());
+
+    if (load_file.empty())
+        return;
+
+    for (VarLike& vl : restore(load_file, script_key))
+        Interpreter::variables[vl.name] = std::move(vl);
+
+    // the functions defined before the checkpoint are still registered when the statements after it run
+    auto last = std::remove_if(program.statements.begin(), checkpoint,
+        [](const Statement& stmt) { return stmt.type != StatementType::DEF_FUNC; });
+    program.statements.erase(last, checkpoint);
+}
+
+void gvl::Snapshot::checkpoint()
+{
+    if (save_file.empty())
+        return;
+
+    std::string image(magic, magic_size);
+    write_u64(image, script_key);
+
+    const Interpreter::VarLikeMap& variables = Interpreter::variables;
+    write_u64(image, variables.size() - variables.count("$ARGS"));
+
+    for (const auto& [ name, vl ] : variables)
+    {
+        // the arguments are part of the key, a run sets them itself
+        if (name == "$ARGS")
+            continue;
+
+        write_token(image, name);
+        image.push_back(static_cast<char>(vl.type));
+        image.push_back(static_cast<char>(vl.is_const));
+        write_token(image, vl.value);
+
+        write_u64(image, vl.array_elements.size());
+        for (const Token& element : vl.array_elements)
+            write_token(image, element);
+
+        write_u64(image, vl.dict_entries.size());
+        for (const Dict::Entry& entry : vl.dict_entries)
+        {
+            write_token(image, entry.key);
+            write_token(image, entry.value);
+        }
+    }
+
+    // written aside and renamed, an interrupted save leaves the previous image intact
+    const std::string tmp_file = save_file + ".tmp";
+    std::ofstream out(tmp_file, std::ios::binary | std::ios::trunc);
+
+    if (!out)
+        throw std::runtime_error("can not open '" + tmp_file + "'");
+
+    out.write(image.data(), image.size());
+    out.close();
+
+    if (!out || std::rename(tmp_file.c_str(), save_file.c_str()) != 0)
+        throw std::runtime_error("can not write '" + save_file + "'");
+}
@@ -0,0 +1,168 @@
+#include "../includes/StrOps.hpp"
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+
+namespace
+{
+    // position of the first needle in text, size when there is none; the needle is not empty
+    using FindKernel = std::size_t (*)(const char* text, std::size_t size, const char* needle, std::size_t needle_size);
+}
+
+
+static std::size_t find_scalar(const char* text, std::size_t size, const char* needle, std::size_t needle_size)
+{
+    const std::size_t pos = gvl::TokenSv(text, size).find(gvl::TokenSv(needle, needle_size));
+    return pos == gvl::TokenSv::npos ? size : pos;
+}
+
+#if defined(__x86_64__)
+
+// the bytes between the first and the last one, which the block compare has matched already
+static inline bool matches_inside(const char* candidate, const char* needle, std::size_t needle_size)
+{
+    return needle_size <= 2 || std::memcmp(candidate + 1, needle + 1, needle_size - 2) == 0;
+}
+
+// blocks are loaded at i and at i + needle_size - 1, so the last byte of both loads stays inside the text
+static std::size_t find_sse2(const char* text, std::size_t size, const char* needle, std::size_t needle_size)
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_size - 1]);
+    std::size_t i = 0;
+
+    for (; i + needle_size - 1 + 16 <= size; i += 16)
+    {
+        const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + needle_size - 1));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last))));
+
+        for (; mask != 0; mask &= mask - 1)
+        {
+            const std::size_t candidate = i + static_cast<std::size_t>(__builtin_ctz(mask));
+
+            if (matches_inside(text + candidate, needle, needle_size))
+                return candidate;
+        }
+    }
+
+    return i + find_scalar(text + i, size - i, needle, needle_size);
+}
+
+__attribute__((target("avx2")))
+static std::size_t find_avx2(const char* text, std::size_t size, const char* needle, std::size_t needle_size)
+{
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_size - 1]);
+    std::size_t i = 0;
+
+    for (; i + needle_size - 1 + 32 <= size; i += 32)
+    {
+        const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        const __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i + needle_size - 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last))));
+
+        for (; mask != 0; mask &= mask - 1)
+        {
+            const std::size_t candidate = i + static_cast<std::size_t>(__builtin_ctz(mask));
+
+            if (matches_inside(text + candidate, needle, needle_size))
+                return candidate;
+        }
+    }
+
+    return i + find_sse2(text + i, size - i, needle, needle_size);
+}
+
+#endif
+
+static FindKernel pick_kernel()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? find_avx2 : find_sse2;
+#else
+    return find_scalar;
+#endif
+}
+
+std::size_t gvl::StrOps::find(TokenSv text, TokenSv needle, std::size_t from)
+{
+    static const FindKernel kernel = pick_kernel();
+
+    if (from >= text.size())
+        return text.size();
+
+    if (needle.empty())
+        return from;
+
+    return from + kernel(text.data() + from, text.size() - from, needle.data(), needle.size());
+}
+
+std::size_t gvl::StrOps::count(TokenSv text, TokenSv needle)
+{
+    std::size_t occurrences = 0;
+
+    if (needle.empty())
+        return occurrences;
+
+    for (std::size_t pos = find(text, needle); pos < text.size(); pos = find(text, needle, pos + needle.size()))
+        ++occurrences;
+
+    return occurrences;
+}
+
+std::vector<gvl::Token> gvl::StrOps::split(TokenSv text, TokenSv separator)
+{
+    std::vector<Token> pieces;
+
+    if (separator.empty())
+    {
+        pieces.reserve(text.size());
+        for (char c : text)
+            pieces.emplace_back(1, c);
+
+        return pieces;
+    }
+
+    std::size_t begin = 0;
+
+    while (begin <= text.size())
+    {
+        const std::size_t end = find(text, separator, begin);
+
+        // runs of separators, and separators at either end, leave no empty pieces
+        if (end > begin)
+            pieces.emplace_back(text.substr(begin, end - begin));
+
+        begin = end + separator.size();
+    }
+
+    return pieces;
+}
+
+gvl::Token gvl::StrOps::replace(TokenSv text, TokenSv from, TokenSv to)
+{
+    Token result;
+
+    if (from.empty())
+        return Token(text);
+
+    result.reserve(text.size());
+    std::size_t begin = 0;
+
+    for (std::size_t pos = find(text, from); pos < text.size(); pos = find(text, from, begin))
+    {
+        result.append(text.substr(begin, pos - begin));
+        result.append(to);
+        begin = pos + from.size();
+    }
+
+    result.append(text.substr(begin));
+    return result;
+}
@@ -0,0 +1,238 @@
+#include "../includes/ThreadPool.hpp"
+#include <algorithm>
+#include <exception>
+#include <chrono>
+
+
+std::size_t gvl::ThreadPool::shared_threads_no = 0;
+
+// index of the calling thread's own queue, or -1 for spares and threads outside of the pool
+static thread_local long worker_idx = -1;
+static thread_local const gvl::ThreadPool* worker_pool = nullptr;
+
+
+static void wait_until(const std::function<bool()>& done)
+{
+    for (std::size_t idle = 0; !done(); ++idle)
+    {
+        if (idle < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+gvl::ThreadPool::ThreadPool(std::size_t threads)
+{
+    threads = std::max<std::size_t>(threads, 1);
+
+    for (std::size_t i = 0; i < threads; ++i)
+        this->queues.push_back(std::make_unique<WorkerQueue>());
+
+    for (std::size_t i = 0; i < threads; ++i)
+        this->workers.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+gvl::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->sleep_mutex);
+        this->stop = true;
+    }
+    this->wake_up.notify_all();
+
+    for (std::thread& worker : this->workers)
+        worker.join();
+
+    for (std::thread& spare : this->spares)
+        spare.join();
+}
+
+gvl::ThreadPool& gvl::ThreadPool::shared()
+{
+    static ThreadPool pool(shared_threads_no > 0 ? shared_threads_no : std::thread::hardware_concurrency());
+    return pool;
+}
+
+void gvl::ThreadPool::submit(Task task)
+{
+    submit(std::move(task), nullptr);
+}
+
+void gvl::ThreadPool::submit(Task task, const void* group)
+{
+    const std::size_t idx = worker_pool == this && worker_idx >= 0 ?
+        static_cast<std::size_t>(worker_idx) : this->next_queue++ % this->queues.size();
+
+    {
+        std::lock_guard<std::mutex> lock(this->sleep_mutex);
+        ++this->queued;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->queues[idx]->mutex);
+        this->queues[idx]->tasks.push_back(QueuedTask{ std::move(task), group });
+    }
+
+    this->wake_up.notify_all();
+}
+
+bool gvl::ThreadPool::try_run_one(const void* group)
+{
+    const std::size_t sz = this->queues.size();
+    const bool is_worker = worker_pool == this && worker_idx >= 0;
+    const std::size_t own = is_worker ? static_cast<std::size_t>(worker_idx) : 0;
+    Task task;
+
+    for (std::size_t i = 0; i < sz && !task; ++i)
+    {
+        WorkerQueue& queue = *this->queues[(own + i) % sz];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tasks.empty())
+            continue;
+
+        if (group != nullptr)
+        {
+            auto it = std::find_if(queue.tasks.begin(), queue.tasks.end(), 
+                [group](const QueuedTask& queued_task) { return queued_task.group == group; });
+
+            if (it != queue.tasks.end())
+            {
+                task = std::move(it->task);
+                queue.tasks.erase(it);
+            }
+        }
+        // own queue is used as a stack, victims are robbed from the other end
+        else if (i == 0 && is_worker)
+        {
+            task = std::move(queue.tasks.back().task);
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(queue.tasks.front().task);
+            queue.tasks.pop_front();
+        }
+    }
+
+    if (!task)
+        return false;
+
+    --this->queued;
+    task();
+    return true;
+}
+
+void gvl::ThreadPool::worker_loop(std::size_t idx)
+{
+    worker_idx = static_cast<long>(idx);
+    worker_pool = this;
+
+    for (;;)
+    {
+        if (try_run_one())
+            continue;
+
+        std::unique_lock<std::mutex> lock(this->sleep_mutex);
+        this->wake_up.wait(lock, [this]() { return this->stop || this->queued > 0; });
+
+        if (this->stop)
+            return;
+    }
+}
+
+// spares run tasks only while fewer of them are busy than workers are blocked
+void gvl::ThreadPool::spare_loop()
+{
+    worker_pool = this;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(this->sleep_mutex);
+            this->wake_up.wait(lock, [this]() 
+            { 
+                return this->stop || (this->queued > 0 && this->active_spares < this->blocked); 
+            });
+
+            if (this->stop)
+                return;
+
+            ++this->active_spares;
+        }
+
+        const bool ran = try_run_one();
+
+        {
+            std::lock_guard<std::mutex> lock(this->sleep_mutex);
+            --this->active_spares;
+        }
+        this->wake_up.notify_all();
+
+        if (!ran)
+            std::this_thread::yield();
+    }
+}
+
+void gvl::ThreadPool::block_until(const std::function<bool()>& done)
+{
+    // threads outside of the pool do not take a worker's place while they wait
+    if (worker_pool != this)
+    {
+        wait_until(done);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->sleep_mutex);
+        ++this->blocked;
+
+        if (this->spares.size() < this->blocked)
+            this->spares.emplace_back(&ThreadPool::spare_loop, this);
+    }
+    this->wake_up.notify_all();
+
+    wait_until(done);
+
+    std::lock_guard<std::mutex> lock(this->sleep_mutex);
+    --this->blocked;
+}
+
+void gvl::ThreadPool::parallel_for(std::size_t n, std::size_t chunks, const ChunkBody& body)
+{
+    chunks = std::clamp<std::size_t>(chunks, 1, std::max<std::size_t>(n, 1));
+
+    std::atomic<std::size_t> remaining = chunks;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+    {
+        const std::size_t begin = n * chunk / chunks;
+        const std::size_t end = n * (chunk + 1) / chunks;
+
+        submit([&, begin, end, chunk]()
+        {
+            try { body(begin, end, chunk); }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+
+            --remaining;
+        }, &remaining);
+    }
+
+    // chunks of other loops or spawned tasks are left alone, they might wait for this thread
+    while (remaining > 0)
+    {
+        if (!try_run_one(&remaining))
+            std::this_thread::yield();
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+}
@@ -0,0 +1,157 @@
+#include "../includes/Tracer.hpp"
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+#include <iomanip>
+#include <fstream>
+#include <stdexcept>
+
+
+std::atomic<bool> gvl::Tracer::enabled = false;
+
+static std::chrono::steady_clock::time_point start;
+
+namespace
+{
+    struct Event
+    {
+        const char* category;
+        char name[32];
+        std::uint32_t line_no;
+        std::uint64_t begin;
+        std::uint64_t duration;
+        std::uint64_t iterations;
+    };
+
+    // written by its thread only, count is published after the event so a reader sees whole events
+    struct Buffer
+    {
+        std::vector<Event> events;
+        std::atomic<std::size_t> count=0;
+        std::size_t thread_no=0;
+    };
+}
+
+// buffers outlive their threads, so spans of finished pool threads are still written
+static std::mutex buffers_mutex;
+static std::vector<std::unique_ptr<Buffer>> buffers;
+
+static Buffer& thread_buffer()
+{
+    static thread_local Buffer* buffer = nullptr;
+
+    if (buffer == nullptr)
+    {
+        auto owned = std::make_unique<Buffer>();
+        owned->events.resize(gvl::Tracer::buffer_capacity);
+
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        owned->thread_no = buffers.size() + 1;
+        buffer = owned.get();
+        buffers.push_back(std::move(owned));
+    }
+
+    return *buffer;
+}
+
+static void write_escaped(std::ofstream& out, const char* str)
+{
+    for (; *str != '\0'; ++str)
+    {
+        if (*str == '"' || *str == '\\')
+            out << '\\';
+        out << *str;
+    }
+}
+
+
+void gvl::Tracer::enable()
+{
+    start = std::chrono::steady_clock::now();
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+std::uint64_t gvl::Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void gvl::Tracer::record(const char* category, TokenSv name, std::size_t line_no, std::uint64_t begin, std::size_t iterations)
+{
+    Buffer& buffer = thread_buffer();
+    const std::size_t count = buffer.count.load(std::memory_order_relaxed);
+    Event& event = buffer.events[count % buffer_capacity];
+
+    const std::size_t length = std::min(name.size(), sizeof(event.name) - 1);
+    std::memcpy(event.name, name.data(), length);
+    event.name[length] = '\0';
+
+    event.category = category;
+    event.line_no = static_cast<std::uint32_t>(line_no);
+    event.begin = begin;
+    event.duration = now() - begin;
+    event.iterations = iterations;
+
+    buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void gvl::Tracer::write(const std::string& file_name)
+{
+    std::ofstream out(file_name, std::ios::trunc);
+
+    if (!out)
+        throw std::runtime_error("can not open '" + file_name + "'");
+
+    // timestamps are in microseconds
+    out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+
+    bool first = true;
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+
+    for (const auto& buffer : buffers)
+    {
+        const std::size_t count = buffer->count.load(std::memory_order_acquire);
+        const std::size_t kept = std::min(count, buffer_capacity);
+
+        for (std::size_t i = count - kept; i < count; ++i)
+        {
+            const Event& event = buffer->events[i % buffer_capacity];
+
+            out << (first ? "" : ",\n") << "{\"name\":\"";
+            write_escaped(out, event.name);
+            out << "\",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_no
+                << ",\"ts\":" << event.begin / 1000.0 << ",\"dur\":" << event.duration / 1000.0
+                << ",\"args\":{\"line\":" << event.line_no << ",\"iterations\":" << event.iterations << "}}";
+
+            first = false;
+        }
+
+        if (count > kept)
+        {
+            out << (first ? "" : ",\n") << "{\"name\":\"dropped spans\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":"
+                << buffer->thread_no << ",\"ts\":0,\"args\":{\"count\":" << count - kept << "}}";
+            first = false;
+        }
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+    if (!out)
+        throw std::runtime_error("can not write '" + file_name + "'");
+}
+
+gvl::Tracer::Span::Span(const char* category, TokenSv name, std::size_t line_no)
+    : category(category), name(name), line_no(line_no)
+{
+    if (is_enabled())
+        this->begin = now();
+}
+
+gvl::Tracer::Span::~Span()
+{
+    if (is_enabled())
+        record(this->category, this->name, this->line_no, this->begin, this->iterations);
+}
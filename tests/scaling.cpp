@@ -0,0 +1,242 @@
+// Runs generated gvl programs at growing sizes and fails when the time or the memory they take grows faster
+// than the complexity class declared for them. Every program is run by the gvl binary in a child process of
+// its own, time is the CPU time of the child and memory its peak resident set, both less those of an empty
+// program. The growth exponent is the slope of the least squares line through log(size) and log(cost).
+//
+// usage: scaling path/to/gvl
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    enum class Growth { CONSTANT, LINEAR };
+
+    struct Dimension
+    {
+        std::string name;
+        std::size_t size;                                     // the smallest one, doubled for every further run
+        Growth time;
+        Growth memory;
+        std::function<std::string(std::size_t)> generate;
+    };
+
+    struct Cost
+    {
+        double seconds;
+        double kib;
+    };
+}
+
+static constexpr std::size_t runs_per_dimension = 4;
+static constexpr std::size_t repetitions = 3;                 // the cheapest of them counts, the others are noise
+
+// a log-log slope this much above the class still passes, quadratic growth lands near 1 above linear
+static constexpr double tolerance = 0.35;
+
+// costs below these are too small to fit a slope to, they count as constant
+static constexpr double min_seconds = 0.02;
+static constexpr double min_kib = 4096;
+
+static const char* const script_file = "/tmp/gvl_scaling.gvl";
+
+
+static std::string nesting(std::size_t depth)
+{
+    std::ostringstream oss;
+    oss << "var d = 0\n";
+
+    for (std::size_t i = 0; i < depth; ++i)
+        oss << "if d >= 0 {\n";
+
+    oss << "d = d + 1\n";
+
+    for (std::size_t i = 0; i < depth; ++i)
+        oss << "}\n";
+
+    oss << "println d\n";
+    return oss.str();
+}
+
+static std::string loop(std::size_t iterations)
+{
+    std::ostringstream oss;
+    oss << "var i = 0\nvar s = 0.5\n"
+        << "while i < " << iterations << " {\n    i = i + 1\n    s = s + 1.5\n}\n"
+        << "println i\n";
+    return oss.str();
+}
+
+static std::string array(std::size_t length)
+{
+    std::ostringstream oss;
+    oss << "var[] a = []\nvar i = 0\n"
+        << "while i < " << length << " {\n    $array_append a i\n    i = i + 1\n}\n"
+        << "var sum = 0\nvar j = 0\nvar len = $array_len a\n"
+        << "while j < len {\n    var e = $array_at a j\n    sum = sum + e\n    j = j + 1\n}\n"
+        << "println sum\n";
+    return oss.str();
+}
+
+static std::string functions(std::size_t count)
+{
+    std::ostringstream oss;
+
+    for (std::size_t i = 0; i < count; ++i)
+        oss << "function f" << i << " : a b {\n    b = a + " << i << "\n}\n";
+
+    oss << "var x = 1\nvar r = 0\n";
+
+    for (std::size_t i = 0; i < count; ++i)
+        oss << "call f" << i << " x r\n";
+
+    oss << "println r\n";
+    return oss.str();
+}
+
+static std::string concatenation(std::size_t appends)
+{
+    std::ostringstream oss;
+    oss << "var chunk = '" << std::string(256, 'x') << "'\nvar s = 'y'\nvar i = 0\n"
+        << "while i < " << appends << " {\n    s = s + chunk\n    i = i + 1\n}\n"
+        << "var len = $str_len s\nprintln len\n";
+    return oss.str();
+}
+
+// the cheapest of the repetitions, the JIT is off so the interpreter's own costs are measured
+static Cost measure(const std::string& gvl, const std::string& source)
+{
+    std::ofstream(script_file) << source;
+    Cost best{ 1e9, 1e18 };
+
+    for (std::size_t r = 0; r < repetitions; ++r)
+    {
+        const pid_t pid = fork();
+
+        if (pid < 0)
+        {
+            std::perror("fork");
+            std::exit(2);
+        }
+
+        if (pid == 0)
+        {
+            const int null = open("/dev/null", O_WRONLY);
+            dup2(null, STDOUT_FILENO);
+            execl(gvl.c_str(), gvl.c_str(), "--no-jit", script_file, static_cast<char*>(nullptr));
+            _exit(127);
+        }
+
+        int status = 0;
+        rusage usage;
+        wait4(pid, &status, 0, &usage);
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            std::cerr << gvl << " failed on a generated program, kept in " << script_file << "\n";
+            std::exit(2);
+        }
+
+        const double seconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+                             + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+
+        best.seconds = std::min(best.seconds, seconds);
+        best.kib = std::min(best.kib, static_cast<double>(usage.ru_maxrss));
+    }
+
+    return best;
+}
+
+static double slope(const std::vector<double>& sizes, const std::vector<double>& costs)
+{
+    const double n = static_cast<double>(sizes.size());
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+
+    for (std::size_t i = 0; i < sizes.size(); ++i)
+    {
+        const double x = std::log(sizes[i]);
+        const double y = std::log(costs[i]);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+
+    return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+}
+
+// true when costs grow no faster than the class allows
+static bool fits(const char* what, Growth growth, const std::vector<double>& sizes, std::vector<double> costs, double min_cost)
+{
+    const bool measurable = costs.back() >= min_cost;
+    for (double& cost : costs)
+        cost = std::max(cost, min_cost / 16);
+
+    const double exponent = measurable ? slope(sizes, costs) : 0;
+    const double allowed = (growth == Growth::LINEAR ? 1 : 0) + tolerance;
+    const bool ok = exponent <= allowed;
+
+    std::cout << "  " << what << " ~ n^" << std::round(exponent * 100) / 100 << (measurable ? "" : " (too small to fit)")
+              << ", at most n^" << allowed << (ok ? "" : "  FAILED") << "\n";
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "usage: " << argv[0] << " path/to/gvl\n";
+        return 2;
+    }
+
+    const std::string gvl = argv[1];
+
+    const std::vector<Dimension> dimensions =
+    {
+        { "nesting depth", 1000, Growth::LINEAR, Growth::LINEAR, nesting },
+        { "loop count", 2500, Growth::LINEAR, Growth::CONSTANT, loop },
+        { "array length", 1500, Growth::LINEAR, Growth::LINEAR, array },
+        { "number of functions", 1000, Growth::LINEAR, Growth::LINEAR, functions },
+        { "string length", 2500, Growth::LINEAR, Growth::LINEAR, concatenation },
+    };
+
+    const Cost empty = measure(gvl, "var e = 0\n");
+    bool ok = true;
+
+    for (const Dimension& dimension : dimensions)
+    {
+        std::vector<double> sizes, seconds, kib;
+
+        std::cout << dimension.name << ":";
+
+        for (std::size_t size = dimension.size, i = 0; i < runs_per_dimension; size *= 2, ++i)
+        {
+            const Cost cost = measure(gvl, dimension.generate(size));
+            sizes.push_back(static_cast<double>(size));
+            seconds.push_back(cost.seconds - empty.seconds);
+            kib.push_back(cost.kib - empty.kib);
+
+            std::cout << " " << size << " (" << cost.seconds << " s, " << cost.kib / 1024 << " MiB)";
+        }
+
+        std::cout << "\n";
+        ok = fits("time", dimension.time, sizes, seconds, min_seconds) && ok;
+        ok = fits("memory", dimension.memory, sizes, kib, min_kib) && ok;
+    }
+
+    std::remove(script_file);
+    std::cout << (ok ? "scaling test passed\n" : "scaling test FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+// Exercises the embedding API of includes/Script.hpp: variables and arrays injected by the host, captured
+// output, the typed getters, the errors a host sees, runs of one Script on several threads at once, and
+// Scripts compiled on several threads at once, whose calls the optimizer inlines and whose loops it hoists.
+//
+// usage: script
+
+#include "Script.hpp"
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    struct Case
+    {
+        std::string name;
+        std::function<bool()> check;
+    };
+}
+
+static constexpr std::size_t threads = 4;
+static constexpr std::size_t runs_per_thread = 25;
+
+// both calls are inlined and the loop's k * k is hoisted into a hidden variable named by the optimizer
+static const char* const compiled_source =
+    "function add : a b c {\n    c = a + b\n}\n"
+    "function twice : a b {\n    b = a * 2\n}\n"
+    "var r = 0\nvar q = 0\n"
+    "call add x x r\ncall twice r q\n"
+    "var i = 0\nvar s = 0\nvar k = x + 1\n"
+    "while i < 10 {\n    var t = k * k\n    s = s + t\n    i = i + 1\n}\n"
+    "var u = k * k\nvar w = k * k\n"
+    "println q\n";
+
+
+static bool expect(bool condition, const std::string& what)
+{
+    if (!condition)
+        std::cout << "    " << what << "\n";
+
+    return condition;
+}
+
+// the values compiled_source leaves behind for x
+static bool check_compiled(const gvl::Execution& execution, long long x)
+{
+    const long long k = x + 1;
+
+    return expect(execution.get_int("r") == 2 * x, "add was not applied")
+        && expect(execution.get_int("q") == 4 * x, "twice was not applied")
+        && expect(execution.get_int("s") == 10 * k * k, "the loop summed a wrong value")
+        && expect(execution.get_int("u") == k * k && execution.get_int("w") == k * k, "a repeated value differs")
+        && expect(execution.get_output() == std::to_string(4 * x) + "\n", "the output differs");
+}
+
+static bool injected_values()
+{
+    const gvl::Script script = gvl::Script::from_source(
+        "var n = $array_len a\nvar first = $array_at a 0\nvar m = x * 2\nvar h = d + 0.5\n"
+        "var g = greeting + '!'\nvar[] b = []\n$array_append b m\n$array_append b first\n");
+
+    gvl::Execution execution(script);
+    execution.set_variable("x", "21").set_variable("d", "1.25").set_variable("greeting", "hello")
+             .set_array("a", { "7", "8", "9" });
+    execution.run();
+
+    return expect(execution.get_int("n") == 3, "the injected array has a wrong length")
+        && expect(execution.get_int("first") == 7, "the injected array has a wrong element")
+        && expect(execution.get_int("m") == 42, "the injected int was not used")
+        && expect(execution.get_double("h") == 1.75, "the injected double was not used")
+        && expect(execution.get_string("g") == "hello!", "the injected string was not used")
+        && expect(execution.get_array("b") == std::vector<gvl::Token>{ "42", "7" }, "the array left behind differs")
+        && expect(execution.has_variable("x") && !execution.has_variable("missing"), "has_variable() is wrong");
+}
+
+static bool captured_output()
+{
+    const gvl::Script script = gvl::Script::from_source("var a = 0\nreadint a\nvar c = a * 2\nprintln c\n");
+    std::istringstream input("21\n");
+
+    gvl::Execution execution(script);
+    execution.set_input(input).capture_output();
+    execution.run();
+
+    return expect(execution.get_int("c") == 42, "the input was not read")
+        && expect(execution.get_output() == "42\n", "the output was not captured");
+}
+
+static bool runs_are_independent()
+{
+    const gvl::Script script = gvl::Script::from_source("var y = x + 1\nprintln y\n");
+
+    gvl::Execution first(script), second(script);
+    first.set_variable("x", "1").capture_output();
+    second.set_variable("x", "2").capture_output();
+    first.run();
+    second.run();
+    first.run();
+
+    return expect(first.get_int("y") == 2 && second.get_int("y") == 3, "a run saw another run's variables")
+        && expect(first.get_output() == "2\n", "a repeated run kept the previous run's output");
+}
+
+static bool error_paths()
+{
+    bool ok = true;
+
+    try
+    {
+        gvl::Execution execution(gvl::Script::from_source("var r = 0\ncall nowhere r\n"));
+        execution.capture_output();
+        execution.run();
+        ok = expect(false, "calling an undefined function did not throw") && ok;
+    }
+    catch (const gvl::Interpreter::RunTimeError& error)
+    {
+        ok = expect(error.get_code() == gvl::Interpreter::ErrorCode::UNDEFINED_FUNCTION, "a wrong error code") && ok;
+    }
+
+    try
+    {
+        gvl::Script::from_source("frobnicate x\n");
+        ok = expect(false, "a malformed script was parsed") && ok;
+    }
+    catch (const gvl::Parser::ParseTimeError&)
+    {
+    }
+
+    try
+    {
+        gvl::Execution execution(gvl::Script::from_source("var a = 1\n"));
+        execution.run();
+        execution.get_variable("b");
+        ok = expect(false, "an unknown variable was found") && ok;
+    }
+    catch (const std::out_of_range&)
+    {
+    }
+
+    // a failed run leaves nothing behind for the next one on the same thread
+    gvl::Execution execution(gvl::Script::from_source("var z = 5\n"));
+    execution.run();
+    return expect(execution.get_int("z") == 5 && !execution.has_variable("r"), "a failed run left state behind") && ok;
+}
+
+static bool concurrent_runs()
+{
+    const gvl::Script script = gvl::Script::from_source(compiled_source);
+    std::atomic<bool> ok = true;
+    std::vector<std::thread> workers;
+
+    for (std::size_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]
+        {
+            for (std::size_t i = 0; i < runs_per_thread; ++i)
+            {
+                const long long x = static_cast<long long>(t * 1000 + i);
+
+                gvl::Execution execution(script);
+                execution.set_variable("x", std::to_string(x)).capture_output();
+                execution.run();
+
+                if (!check_compiled(execution, x))
+                    ok = false;
+            }
+        });
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    return ok;
+}
+
+// every thread compiles its own Scripts while the others do, so the optimizer runs concurrently
+static bool concurrent_compiles()
+{
+    std::atomic<bool> ok = true;
+    std::vector<std::thread> workers;
+
+    for (std::size_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]
+        {
+            for (std::size_t i = 0; i < runs_per_thread; ++i)
+            {
+                const long long x = static_cast<long long>(t + i);
+
+                gvl::Execution execution(gvl::Script::from_source(compiled_source));
+                execution.set_variable("x", std::to_string(x)).capture_output();
+                execution.run();
+
+                if (!check_compiled(execution, x))
+                    ok = false;
+            }
+        });
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    return ok;
+}
+
+int main()
+{
+    const std::vector<Case> cases =
+    {
+        { "injected values", injected_values },
+        { "captured output", captured_output },
+        { "independent runs", runs_are_independent },
+        { "errors", error_paths },
+        { "concurrent runs", concurrent_runs },
+        { "concurrent compiles", concurrent_compiles },
+    };
+
+    bool ok = true;
+
+    for (const Case& test : cases)
+    {
+        bool passed = false;
+
+        try
+        {
+            passed = test.check();
+        }
+        catch (const gvl::Error& error)
+        {
+            std::cout << "    " << error.what() << "\n";
+        }
+        catch (const std::exception& error)
+        {
+            std::cout << "    " << error.what() << "\n";
+        }
+
+        std::cout << test.name << (passed ? ": ok\n" : ": FAILED\n");
+        ok = passed && ok;
+    }
+
+    std::cout << (ok ? "script test passed\n" : "script test FAILED\n");
+    return ok ? 0 : 1;
+}